@@ -129,28 +129,19 @@ static char*
 }
 
 // Return the current time formatted as 2016-04-29 @ 20:44:13 (used for logging)
-// NOTE: The use of static variables prevents this from being thread-safe,
-//       but in the main thread, we use static storage for simplicity's sake.
+// NOTE: We use thread-local static storage for simplicity's sake,
+//       which makes this safe to use from both the main thread & the DB worker thread.
 static char*
     get_current_time(void)
 {
-	static struct tm    local_tm = { 0 };
-	struct tm* restrict lt       = get_localtime(&local_tm);
+	static __thread struct tm local_tm = { 0 };
+	struct tm* restrict       lt       = get_localtime(&local_tm);
 
-	static char sz_time[22];
+	static __thread char sz_time[22];
 
 	return format_localtime(lt, sz_time, sizeof(sz_time));
 }
 
-// And now the same, but with user supplied storage, thus potentially thread-safe:
-// e.g., we use the stack in reaper_thread().
-static char*
-    get_current_time_r(struct tm* restrict local_tm, char* restrict sz_time, size_t len)
-{
-	struct tm* restrict lt = get_localtime(local_tm);
-	return format_localtime(lt, sz_time, len);
-}
-
 static const char*
     get_log_prefix(int prio)
 {
@@ -173,68 +164,399 @@ static const char*
 	}
 }
 
-// Check that our target mountpoint is indeed mounted...
+// Start keeping track of our target mountpoint
+// NOTE: This happens before we even have an event loop (c.f., load_config), which only picks it up later, c.f., main.
+static void
+    init_mount_monitor(void)
+{
+	// NOTE: CLOEXEC not to pollute our spawns.
+	MountMon.fd = open("/proc/self/mountinfo", O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+	if (MountMon.fd == -1) {
+		PFLOG(LOG_ERR, "Aborting: open: %m");
+		exit(EXIT_FAILURE);
+	}
+
+	refresh_mount_state();
+}
+
+// Read the current contents of mountinfo in MountMon.buf (as a NUL-terminated string)
 static bool
-    is_target_mounted(void)
+    read_mountinfo(void)
 {
-	// c.f., http://program-nix.blogspot.com/2008/08/c-language-check-filesystem-is-mounted.html
-	FILE* restrict          mtab       = NULL;
-	struct mntent* restrict part       = NULL;
-	bool                    is_mounted = false;
+	if (lseek(MountMon.fd, 0, SEEK_SET) == -1) {
+		PFLOG(LOG_WARNING, "lseek: %m");
+		return false;
+	}
 
-	if ((mtab = setmntent("/proc/mounts", "r")) != NULL) {
-		while ((part = getmntent(mtab)) != NULL) {
-			DBGLOG("Checking fs %s mounted on %s", part->mnt_fsname, part->mnt_dir);
-			if ((part->mnt_dir != NULL) && (strcmp(part->mnt_dir, KFMON_TARGET_MOUNTPOINT)) == 0) {
-				is_mounted = true;
-				break;
+	size_t len = 0U;
+	while (1) {
+		// NOTE: Always keep room for the NUL.
+		if (MountMon.buf_size - len < 2U) {
+			size_t new_size = MAX(4096U, MountMon.buf_size * 2U);
+			char*  new_buf  = realloc(MountMon.buf, new_size);
+			if (new_buf == NULL) {
+				PFLOG(LOG_ERR, "realloc: %m");
+				return false;
+			}
+			MountMon.buf      = new_buf;
+			MountMon.buf_size = new_size;
+		}
+		ssize_t n = read(MountMon.fd, MountMon.buf + len, MountMon.buf_size - len - 1U);    // Flawfinder: ignore
+		if (n == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			PFLOG(LOG_WARNING, "read: %m");
+			return false;
+		}
+		if (n == 0) {
+			break;
+		}
+		len += (size_t) n;
+	}
+	MountMon.buf[len] = '\0';
+
+	return true;
+}
+
+// Pick the mount ID & the (still escaped) mountpoint out of the mountinfo line spanning [line, eol)
+// NOTE: c.f., proc(5): mount ID, parent ID, major:minor, root, mountpoint, and a bunch of stuff we don't care about.
+static bool
+    parse_mountinfo_line(const char* line, const char* eol, uint32_t* mnt_id, const char** mnt_dir, size_t* mnt_dir_len)
+{
+	char*             end = NULL;
+	unsigned long int id  = strtoul(line, &end, 10);
+	if (end == line || end >= eol) {
+		return false;
+	}
+
+	const char* field = line;
+	for (uint8_t i = 0U; i < 4U; i++) {
+		field = memchr(field, ' ', (size_t) (eol - field));
+		if (field == NULL) {
+			return false;
+		}
+		field++;
+	}
+	const char* field_end = memchr(field, ' ', (size_t) (eol - field));
+	if (field_end == NULL) {
+		return false;
+	}
+
+	*mnt_id      = (uint32_t) id;
+	*mnt_dir     = field;
+	*mnt_dir_len = (size_t) (field_end - field);
+	return true;
+}
+
+// A mount's key: its ID, and an FNV-1a hash of its mountpoint (so that we also notice a mount being moved)
+static uint64_t
+    get_mount_key(uint32_t mnt_id, const char* mnt_dir, size_t mnt_dir_len)
+{
+	uint32_t h = 2166136261U;
+	for (size_t i = 0U; i < mnt_dir_len; i++) {
+		h ^= (unsigned char) mnt_dir[i];
+		h *= 16777619U;
+	}
+	return ((uint64_t) mnt_id << 32U) | h;
+}
+
+static int
+    compare_mount_keys(const void* a, const void* b)
+{
+	const uint64_t ka = *(const uint64_t*) a;
+	const uint64_t kb = *(const uint64_t*) b;
+	return (ka > kb) - (ka < kb);
+}
+
+// Make sure our snapshots can hold at least count mounts
+static bool
+    grow_mount_keys(size_t count)
+{
+	size_t new_size = MAX(MAX((size_t) 64U, MountMon.size * 2U), count);
+	// NOTE: Both snapshots are swapped after each scan, so, they always have to be of the same size.
+	uint64_t* keys  = realloc(MountMon.keys, new_size * sizeof(*keys));
+	if (keys == NULL) {
+		PFLOG(LOG_ERR, "realloc: %m");
+		return false;
+	}
+	MountMon.keys     = keys;
+	uint64_t* scratch = realloc(MountMon.scratch, new_size * sizeof(*scratch));
+	if (scratch == NULL) {
+		PFLOG(LOG_ERR, "realloc: %m");
+		return false;
+	}
+	MountMon.scratch = scratch;
+	MountMon.size    = new_size;
+	return true;
+}
+
+// Snapshot the key of every mount listed in MountMon.buf in MountMon.scratch (unsorted),
+// and return the key of the topmost mount sitting on our target mountpoint, or 0 if we didn't find any.
+// NOTE: Unless full is set, we only look at the mountpoints of the entries that weren't in our previous snapshot,
+//       since nothing else could have changed.
+//       Mounts are listed in the order they were made, so, the last one on our target mountpoint is the one on top.
+static uint64_t
+    scan_mountinfo(bool full, size_t* count, size_t* added)
+{
+	const size_t target_len = strlen(KFMON_TARGET_MOUNTPOINT);
+	uint64_t     target_key = 0U;
+
+	*count = 0U;
+	*added = 0U;
+	for (const char* line = MountMon.buf; *line != '\0';) {
+		const char* eol = strchrnul(line, '\n');
+		uint32_t    mnt_id;
+		const char* mnt_dir;
+		size_t      mnt_dir_len;
+		if (parse_mountinfo_line(line, eol, &mnt_id, &mnt_dir, &mnt_dir_len)) {
+			if (*count >= MountMon.size && !grow_mount_keys(*count + 1U)) {
+				return MountMon.target_key;
+			}
+			uint64_t key    = get_mount_key(mnt_id, mnt_dir, mnt_dir_len);
+			bool     is_new = true;
+			if (MountMon.count > 0U) {
+				is_new =
+				    bsearch(&key, MountMon.keys, MountMon.count, sizeof(key), compare_mount_keys) == NULL;
+			}
+			MountMon.scratch[(*count)++] = key;
+			if (is_new) {
+				(*added)++;
+				DBGLOG("Mount %u on %.*s is new", mnt_id, (int) mnt_dir_len, mnt_dir);
+			}
+			if ((full || is_new) && mnt_dir_len == target_len &&
+			    memcmp(mnt_dir, KFMON_TARGET_MOUNTPOINT, target_len) == 0) {
+				target_key = key;
 			}
 		}
-		endmntent(mtab);
+		line = (*eol == '\n') ? eol + 1 : eol;
+	}
+
+	return target_key;
+}
+
+// Apply a state transition of our target mountpoint
+static void
+    set_mount_state(MountState state)
+{
+	if (state == MOUNT_PRESENT) {
+		// NOTE: The device is purely informative, we tell mounts apart by their keys (c.f., scan_mountinfo),
+		//       which also catches the same device being mounted again.
+		struct stat st = { 0 };
+		if (stat(KFMON_TARGET_MOUNTPOINT, &st) == -1) {
+			PFLOG(LOG_WARNING, "stat: %m");
+		}
+		LOG(LOG_NOTICE,
+		    "%s is now mounted (dev %u:%u)",
+		    KFMON_TARGET_MOUNTPOINT,
+		    major(st.st_dev),
+		    minor(st.st_dev));
+	} else if (MountMon.state == MOUNT_PRESENT) {
+		LOG(LOG_NOTICE, "%s is no longer mounted", KFMON_TARGET_MOUNTPOINT);
+	} else {
+		LOG(LOG_INFO, "%s isn't mounted", KFMON_TARGET_MOUNTPOINT);
+	}
+	MountMon.state = state;
+}
+
+// Mountpoints changed (or we've never looked at them yet), check if that affects our target mountpoint
+static void
+    refresh_mount_state(void)
+{
+	if (!read_mountinfo()) {
+		return;
+	}
+
+	size_t   count;
+	size_t   added;
+	uint64_t target_key = scan_mountinfo(false, &count, &added);
+	qsort(MountMon.scratch, count, sizeof(*MountMon.scratch), compare_mount_keys);
+	// NOTE: Each mount is listed once, so, whatever isn't accounted for by the new ones is gone.
+	size_t removed = MountMon.count + added - count;
+	DBGLOG("Mountpoints changed: %zu new mounts, %zu gone", added, removed);
+
+	if (target_key == 0U && MountMon.target_key != 0U) {
+		// Nothing new was mounted over our target mountpoint, is the one we knew about still there?
+		if (bsearch(&MountMon.target_key, MountMon.scratch, count, sizeof(target_key), compare_mount_keys)) {
+			target_key = MountMon.target_key;
+		} else if (removed > 0U) {
+			// NOTE: It's gone, but it may have been stacked over another one, which won't show up as new,
+			//       so, look at every entry this time.
+			target_key = scan_mountinfo(true, &count, &added);
+			qsort(MountMon.scratch, count, sizeof(*MountMon.scratch), compare_mount_keys);
+		}
+	}
+
+	// Swap our snapshots
+	uint64_t* keys   = MountMon.keys;
+	MountMon.keys    = MountMon.scratch;
+	MountMon.scratch = keys;
+	MountMon.count   = count;
+
+	MountState state = target_key ? MOUNT_PRESENT : MOUNT_ABSENT;
+	if (state == MountMon.state && target_key == MountMon.target_key) {
+		return;
+	}
+	if (state == MountMon.state && state == MOUNT_PRESENT) {
+		LOG(LOG_NOTICE, "Something else was mounted over %s", KFMON_TARGET_MOUNTPOINT);
+	}
+	MountMon.target_key = target_key;
+	set_mount_state(state);
+}
+
+// Mountpoints changed while our event loop was running
+static bool
+    handle_mount_events(int fd __attribute__((unused)),
+			uint32_t events __attribute__((unused)),
+			uint32_t data __attribute__((unused)))
+{
+	refresh_mount_state();
+	if (MountMon.state == MOUNT_ABSENT) {
+		enter_exported_state();
+	}
+	// NOTE: If that took our target files down with it, inotify will let us know soon enough, c.f., handle_events.
+	//       (Provided nothing keeps the filesystem busy, hence enter_exported_state letting go of the DB).
+	return false;
+}
+
+// Check that our target mountpoint is indeed mounted...
+// NOTE: That's usually just our cached state, unless mountinfo changed since we last looked at it
+//       (e.g., if we're back in the main loop before our event loop had a chance to dispatch that).
+static bool
+    is_target_mounted(void)
+{
+	struct pollfd pfd = { .fd = MountMon.fd, .events = POLLPRI };
+	if (MountMon.state == MOUNT_UNKNOWN || (poll(&pfd, 1, 0) > 0 && (pfd.revents & (POLLERR | POLLPRI)))) {
+		refresh_mount_state();
 	}
 
-	return is_mounted;
+	return MountMon.state == MOUNT_PRESENT;
 }
 
-// Monitor mountpoint activity...
+// Wait for our target mountpoint to be mounted, however long it takes...
 static void
     wait_for_target_mountpoint(void)
 {
 	// c.f., https://stackoverflow.com/questions/5070801
-	int           mfd   = open("/proc/mounts", O_RDONLY | O_CLOEXEC);
-	struct pollfd pfd   = { 0 };
-	pfd.fd              = mfd;
-	pfd.events          = POLLERR | POLLPRI;
-	pfd.revents         = 0;
-	uint8_t changes     = 0U;
-	uint8_t max_changes = 6U;
-
-	while (poll(&pfd, 1, -1) >= 0) {
-		if (pfd.revents & POLLERR) {
-			LOG(LOG_INFO, "Mountpoints changed (iteration nr. %d of %hhu)", ++changes, max_changes);
-
-			// Stop polling once we know our mountpoint is available...
-			if (is_target_mounted()) {
-				LOG(LOG_NOTICE, "Yay! Target mountpoint is available!");
-				break;
-			}
-		}
-		pfd.revents = 0;
+	struct pollfd pfd     = { .fd = MountMon.fd, .events = POLLPRI };
+	uint32_t      changes = 0U;
 
-		// If we can't find our mountpoint after that many changes, assume we're screwed...
-		if (changes >= max_changes) {
-			LOG(LOG_ERR, "Too many mountpoint changes without finding our target (shutdown?), aborting!");
-			close(mfd);
-			// NOTE: We have to hide this behind a slightly crappy check, because this runs during load_config,
-			//       at which point FBInk is not yet initialized...
-			if (fbinkConfig.row != 0) {
-				fbink_print(FBFD_AUTO, "[KFMon] Internal storage unavailable, bye!", &fbinkConfig);
+	while (MountMon.state != MOUNT_PRESENT) {
+		if (poll(&pfd, 1, -1) == -1) {
+			if (errno == EINTR) {
+				continue;
 			}
+			PFLOG(LOG_ERR, "Aborting: poll: %m");
 			exit(EXIT_FAILURE);
 		}
+		if (pfd.revents & (POLLERR | POLLPRI)) {
+			LOG(LOG_INFO, "Mountpoints changed (iteration nr. %u)", ++changes);
+			refresh_mount_state();
+		}
+	}
+
+	LOG(LOG_NOTICE, "Yay! Target mountpoint is available!");
+}
+
+// Snapshot what a file looks like right now (left zeroed if we can't stat it)
+static bool
+    get_file_stamp(const char* path, FileStamp* stamp)
+{
+	struct stat st;
+	if (stat(path, &st) == -1) {
+		*stamp = (const FileStamp){ 0 };
+		return false;
+	}
+
+	stamp->mtime = st.st_mtim;
+	stamp->size  = st.st_size;
+	return true;
+}
+
+static bool
+    is_same_file_stamp(const FileStamp* a, const FileStamp* b)
+{
+	return a->mtime.tv_sec == b->mtime.tv_sec && a->mtime.tv_nsec == b->mtime.tv_nsec && a->size == b->size;
+}
+
+// Snapshot Nickel's DB, and its WAL (which may very well not exist, in which case its stamp is zeroed)
+static void
+    get_db_stamps(FileStamp* db_stamp, FileStamp* wal_stamp)
+{
+	get_file_stamp(KOBO_DB_PATH, db_stamp);
+	get_file_stamp(KOBO_DB_WAL_PATH, wal_stamp);
+}
+
+// Our target mountpoint went away while we were running: park everything until it comes back
+// NOTE: What we know about our watches is kept, c.f., leave_exported_state.
+static void
+    enter_exported_state(void)
+{
+	if (daemonState == DAEMON_EXPORTED) {
+		return;
+	}
+
+	LOG(LOG_NOTICE, "%s was exported, parking everything until it comes back", KFMON_TARGET_MOUNTPOINT);
+	daemonState = DAEMON_EXPORTED;
+
+	// Let go of the DB ASAP, as our connections would otherwise keep the filesystem busy
+	reset_db_worker();
+	// NOTE: Whatever was queued was about what's on there, so it's moot now.
+	clear_spawn_queue();
+	// NOTE: Whatever was still in flight will be discarded, c.f., handle_db_verdict.
+	resync_idx = -1;
+	// Same deal for the thumbnails
+	if (daemonConfig.watch_thumbnails) {
+		reset_thumbnail_watches();
+	}
+	// NOTE: Nickel won't process anything while we're exported, so, stop waiting on it.
+	for (uint16_t watch_idx = 0U; watch_idx < watchListSize; watch_idx++) {
+		if (watchConfig[watch_idx].state == WATCH_PENDING || watchConfig[watch_idx].state == WATCH_SETTLING) {
+			set_watch_state(watch_idx, WATCH_IDLE);
+		}
+	}
+}
+
+// Our target mountpoint is back after an export: only forget about what actually changed in the meantime
+// NOTE: The watch configs themselves are handled by update_watch_configs, as we're now DAEMON_RESUMING.
+static void
+    leave_exported_state(void)
+{
+	if (daemonState != DAEMON_EXPORTED) {
+		return;
+	}
+
+	FileStamp db_stamp;
+	FileStamp wal_stamp;
+	get_db_stamps(&db_stamp, &wal_stamp);
+
+	uint16_t kept    = 0U;
+	uint16_t dropped = 0U;
+	for (uint16_t watch_idx = 0U; watch_idx < watchListSize; watch_idx++) {
+		DbVerdict* cache = &watchConfig[watch_idx].db_cache;
+		if (!watchConfig[watch_idx].is_active || !cache->is_valid) {
+			continue;
+		}
+
+		// NOTE: We only ever carry over positive verdicts: Nickel will likely be busy importing stuff
+		//       right after an export, and we'd miss it processing a target file we thought was pending,
+		//       since the verdict is only rebased on our new DB connection on its next lookup.
+		if (cache->exists && is_same_file_stamp(&cache->db_stamp, &db_stamp) &&
+		    is_same_file_stamp(&cache->wal_stamp, &wal_stamp)) {
+			cache->is_carried_over = true;
+			kept++;
+		} else {
+			*cache = (const DbVerdict){ 0 };
+			dropped++;
+		}
 	}
 
-	close(mfd);
+	LOG(LOG_NOTICE,
+	    "%s is back, kept %hu cached DB verdicts, and dropped %hu",
+	    KFMON_TARGET_MOUNTPOINT,
+	    kept,
+	    dropped);
+	daemonState = DAEMON_RESUMING;
 }
 
 // Sanitize user input for keys expecting an unsigned short integer
@@ -293,6 +615,155 @@ static int
 	return EXIT_SUCCESS;
 }
 
+// Sanitize user input for keys expecting a (signed) int
+static int
+    strtol_i(const char* str, int* restrict result)
+{
+	char* endptr;
+	errno        = 0;    // To distinguish success/failure after call
+	long int val = strtol(str, &endptr, 10);
+
+	if ((errno == ERANGE && (val == LONG_MAX || val == LONG_MIN)) || (errno != 0 && val == 0)) {
+		PFLOG(LOG_WARNING, "strtol: %m");
+		return -EINVAL;
+	}
+
+	if (endptr == str) {
+		LOG(LOG_WARNING, "No digits were found in value '%s' assigned to a key expecting an int.", str);
+		return -EINVAL;
+	}
+
+	// Enforce the fact that the input really was *only* an integer value (c.f., strtoul_hu).
+	if (*endptr != '\0') {
+		LOG(LOG_WARNING,
+		    "Found trailing characters (%s) behind value '%ld' assigned from string '%s' to a key expecting an int.",
+		    endptr,
+		    val,
+		    str);
+		return -EINVAL;
+	}
+
+	if (val > INT_MAX || val < INT_MIN) {
+		LOG(LOG_WARNING, "Value '%ld' doesn't fit in an int.", val);
+		return -EINVAL;
+	}
+
+	*result = (int) val;
+	return EXIT_SUCCESS;
+}
+
+// Parse an ionice key: either idle, or best-effort/realtime, optionally followed by a priority level (e.g., realtime:0)
+// Returns it already packed for ioprio_set.
+static int
+    parse_ionice(const char* str, int* restrict result)
+{
+	const char* sep   = strchr(str, ':');
+	size_t      len   = sep ? (size_t) (sep - str) : strlen(str);
+	int         class = 0;
+	if (len == 4U && strncasecmp(str, "idle", len) == 0) {
+		class = IOPRIO_CLASS_IDLE;
+	} else if (len == 11U && strncasecmp(str, "best-effort", len) == 0) {
+		class = IOPRIO_CLASS_BE;
+	} else if (len == 8U && strncasecmp(str, "realtime", len) == 0) {
+		class = IOPRIO_CLASS_RT;
+	} else {
+		LOG(LOG_WARNING, "Unknown I/O scheduling class in '%s' (expected idle, best-effort or realtime).", str);
+		return -EINVAL;
+	}
+
+	// Default to the middle of the road, like the kernel does for best-effort
+	unsigned short int level = 4U;
+	if (sep) {
+		if (class == IOPRIO_CLASS_IDLE) {
+			LOG(LOG_WARNING, "The idle I/O scheduling class doesn't take a priority level.");
+			return -EINVAL;
+		}
+		if (strtoul_hu(sep + 1, &level) < 0 || level > 7U) {
+			LOG(LOG_WARNING, "I/O priority levels range from 0 (highest) to 7 (lowest).");
+			return -EINVAL;
+		}
+	}
+
+	*result = IOPRIO_PRIO_VALUE(class, class == IOPRIO_CLASS_IDLE ? 0 : level);
+	return EXIT_SUCCESS;
+}
+
+// Parse a list of CPUs, in the same format as taskset's --cpu-list (e.g., 0,2-3), into a bitmask
+static int
+    parse_cpu_list(const char* str, uint32_t* restrict result)
+{
+	uint32_t    mask = 0U;
+	const char* p    = str;
+	while (true) {
+		// NOTE: Every item needs an actual CPU number (no dangling ranges or separators).
+		if (!isdigit((unsigned char) *p)) {
+			break;
+		}
+		char*         endptr;
+		unsigned long first = strtoul(p, &endptr, 10);
+		unsigned long last  = first;
+		if (*endptr == '-') {
+			p = endptr + 1;
+			if (!isdigit((unsigned char) *p)) {
+				break;
+			}
+			last = strtoul(p, &endptr, 10);
+		}
+		if (first > last || last > 31U) {
+			LOG(LOG_WARNING, "Invalid CPU range %lu-%lu in '%s' (we only handle CPUs 0 to 31).", first, last, str);
+			return -EINVAL;
+		}
+		for (unsigned long cpu = first; cpu <= last; cpu++) {
+			mask |= 1U << cpu;
+		}
+
+		p = endptr;
+		if (*p == '\0') {
+			*result = mask;
+			return EXIT_SUCCESS;
+		}
+		if (*p != ',') {
+			break;
+		}
+		p++;
+	}
+
+	LOG(LOG_WARNING, "Malformed CPU list '%s' (expected something like 0,2-3).", str);
+	return -EINVAL;
+}
+
+// Sanitize a value we'll write as-is to one of a cgroup's interface files (e.g., 64M, or 50000 100000)
+static int
+    parse_cgroup_value(const char* str, char* restrict result, size_t size)
+{
+	if (*str == '\0') {
+		LOG(LOG_WARNING, "Passed an empty value to a cgroup key.");
+		return -EINVAL;
+	}
+	for (const char* c = str; *c; c++) {
+		if (!isalnum((unsigned char) *c) && *c != ' ') {
+			LOG(LOG_WARNING, "Unexpected character '%c' in cgroup value '%s'.", *c, str);
+			return -EINVAL;
+		}
+	}
+	if (str5cpy(result, size, str, size, NOTRUNC) < 0) {
+		LOG(LOG_WARNING, "Cgroup value '%s' is too long.", str);
+		return -EINVAL;
+	}
+	return EXIT_SUCCESS;
+}
+
+// Check whether two spawn policies are identical
+static bool
+    is_same_spawn_policy(const SpawnPolicy* a, const SpawnPolicy* b)
+{
+	return a->has_nice == b->has_nice && (!a->has_nice || a->nice == b->nice) &&
+	       a->has_oom_score_adj == b->has_oom_score_adj &&
+	       (!a->has_oom_score_adj || a->oom_score_adj == b->oom_score_adj) && a->ioprio == b->ioprio &&
+	       a->cpu_affinity == b->cpu_affinity && strcmp(a->memory_max, b->memory_max) == 0 &&
+	       strcmp(a->cpu_max, b->cpu_max) == 0;
+}
+
 // Sanitize user input for keys expecting a boolean
 // NOTE: Inspired from Linux's strtobool (tools/lib/string.c) as well as sudo's implementation of the same.
 static int
@@ -410,6 +881,26 @@ static int
 			LOG(LOG_CRIT, "Passed an invalid value for with_notifications!");
 			return 0;
 		}
+	} else if (MATCH("daemon", "watch_thumbnails")) {
+		if (strtobool(value, &pconfig->watch_thumbnails) < 0) {
+			LOG(LOG_CRIT, "Passed an invalid value for watch_thumbnails!");
+			return 0;
+		}
+	} else if (MATCH("daemon", "watch_directories")) {
+		if (strtobool(value, &pconfig->watch_directories) < 0) {
+			LOG(LOG_CRIT, "Passed an invalid value for watch_directories!");
+			return 0;
+		}
+	} else if (MATCH("daemon", "use_fanotify")) {
+		if (strtobool(value, &pconfig->use_fanotify) < 0) {
+			LOG(LOG_CRIT, "Passed an invalid value for use_fanotify!");
+			return 0;
+		}
+	} else if (MATCH("daemon", "use_zygote")) {
+		if (strtobool(value, &pconfig->use_zygote) < 0) {
+			LOG(LOG_CRIT, "Passed an invalid value for use_zygote!");
+			return 0;
+		}
 	} else {
 		return 0;    // unknown section/name, error
 	}
@@ -470,6 +961,50 @@ static int
 		if (str5cpy(pconfig->db_comment, DB_SZ_MAX, value, DB_SZ_MAX, TRUNC) != 0) {
 			LOG(LOG_WARNING, "The value passed for db_comment may have been truncated!");
 		}
+	} else if (MATCH("watch", "pending_timeout")) {
+		if (strtoul_hu(value, &pconfig->pending_timeout) < 0) {
+			LOG(LOG_CRIT, "Passed an invalid value for pending_timeout!");
+			return 0;
+		}
+	} else if (MATCH("watch", "settle_delay")) {
+		if (strtoul_hu(value, &pconfig->settle_delay) < 0) {
+			LOG(LOG_CRIT, "Passed an invalid value for settle_delay!");
+			return 0;
+		}
+	} else if (MATCH("watch", "nice")) {
+		if (strtol_i(value, &pconfig->policy.nice) < 0 || pconfig->policy.nice < -20 ||
+		    pconfig->policy.nice > 19) {
+			LOG(LOG_CRIT, "Passed an invalid value for nice (expected -20 to 19)!");
+			return 0;
+		}
+		pconfig->policy.has_nice = true;
+	} else if (MATCH("watch", "ionice")) {
+		if (parse_ionice(value, &pconfig->policy.ioprio) < 0) {
+			LOG(LOG_CRIT, "Passed an invalid value for ionice!");
+			return 0;
+		}
+	} else if (MATCH("watch", "cpu_affinity")) {
+		if (parse_cpu_list(value, &pconfig->policy.cpu_affinity) < 0) {
+			LOG(LOG_CRIT, "Passed an invalid value for cpu_affinity!");
+			return 0;
+		}
+	} else if (MATCH("watch", "oom_score_adj")) {
+		if (strtol_i(value, &pconfig->policy.oom_score_adj) < 0 || pconfig->policy.oom_score_adj < -1000 ||
+		    pconfig->policy.oom_score_adj > 1000) {
+			LOG(LOG_CRIT, "Passed an invalid value for oom_score_adj (expected -1000 to 1000)!");
+			return 0;
+		}
+		pconfig->policy.has_oom_score_adj = true;
+	} else if (MATCH("watch", "memory_max")) {
+		if (parse_cgroup_value(value, pconfig->policy.memory_max, sizeof(pconfig->policy.memory_max)) < 0) {
+			LOG(LOG_CRIT, "Passed an invalid value for memory_max!");
+			return 0;
+		}
+	} else if (MATCH("watch", "cpu_max")) {
+		if (parse_cgroup_value(value, pconfig->policy.cpu_max, sizeof(pconfig->policy.cpu_max)) < 0) {
+			LOG(LOG_CRIT, "Passed an invalid value for cpu_max!");
+			return 0;
+		}
 	} else if (MATCH("watch", "reboot_on_exit")) {
 		;
 	} else {
@@ -492,29 +1027,13 @@ static bool
 	} else {
 		// Make sure we're not trying to set multiple watches on the same file...
 		// (because that would only actually register the first one parsed).
-		uint8_t matches  = 0U;
-		uint8_t bmatches = 0U;
-		for (uint8_t watch_idx = 0U; watch_idx < WATCH_MAX; watch_idx++) {
-			// Only relevant for active watches
-			if (!watchConfig[watch_idx].is_active) {
-				continue;
-			}
-
-			if (strcmp(pconfig->filename, watchConfig[watch_idx].filename) == 0) {
-				matches++;
-			}
-
-			// Check the basename, too, for IPC...
-			if (strcmp(basename(pconfig->filename), basename(watchConfig[watch_idx].filename)) == 0) {
-				bmatches++;
-			}
-		}
-		// As we're not yet flagged active, we won't loop over ourselves ;).
-		if (matches >= 1U) {
+		// As we're not yet flagged active (and registered), we won't match ourselves ;).
+		if (find_watch_by_filename(pconfig->filename) >= 0) {
 			LOG(LOG_WARNING, "Tried to setup multiple watches on file '%s'!", pconfig->filename);
 			sane = false;
 		}
-		if (bmatches >= 1U) {
+		// Check the basename, too, for IPC...
+		if (find_watch_by_basename(basename(pconfig->filename)) >= 0) {
 			LOG(LOG_WARNING,
 			    "Tried to setup multiple watches on files with an identical basename: '%s'!",
 			    basename(pconfig->filename));
@@ -549,7 +1068,7 @@ static bool
 
 // Validate a watch config, and merge it to its final location if it's sane and updated
 static bool
-    validate_and_merge_watch_config(void* user, uint8_t target_idx, bool* was_updated)
+    validate_and_merge_watch_config(void* user, uint16_t target_idx, bool* was_updated)
 {
 	WatchConfig* restrict pconfig = (WatchConfig*) user;
 
@@ -564,34 +1083,15 @@ static bool
 		if (strcmp(pconfig->filename, watchConfig[target_idx].filename) != 0) {
 			// Make sure we're not trying to set multiple watches on the same file...
 			// (because that would only actually register the first one parsed).
-			uint8_t matches  = 0U;
-			uint8_t bmatches = 0U;
-			for (uint8_t watch_idx = 0U; watch_idx < WATCH_MAX; watch_idx++) {
-				// Only relevant for active watches
-				if (!watchConfig[watch_idx].is_active) {
-					continue;
-				}
-
-				// Skip the to-be-updated watch, since we'll overwrite it if this check pans out...
-				if (watch_idx == target_idx) {
-					continue;
-				}
-
-				if (strcmp(pconfig->filename, watchConfig[watch_idx].filename) == 0) {
-					matches++;
-				}
-
-				// Check basename, too, for IPC...
-				if (strcmp(basename(pconfig->filename), basename(watchConfig[watch_idx].filename)) == 0) {
-					bmatches++;
-				}
-			}
-			// We explicitly make sure not to loop over ourselves ;).
-			if (matches >= 1U) {
+			// NOTE: Skip the to-be-updated watch, since we'll overwrite it if this check pans out...
+			int32_t match = find_watch_by_filename(pconfig->filename);
+			if (match >= 0 && match != (int32_t) target_idx) {
 				LOG(LOG_WARNING, "Tried to setup multiple watches on file '%s'!", pconfig->filename);
 				sane = false;
 			}
-			if (bmatches >= 1U) {
+			// Check basename, too, for IPC...
+			match = find_watch_by_basename(basename(pconfig->filename));
+			if (match >= 0 && match != (int32_t) target_idx) {
 				LOG(LOG_WARNING,
 				    "Tried to setup multiple watches on files with an identical basename: '%s'!",
 				    basename(pconfig->filename));
@@ -600,11 +1100,14 @@ static bool
 			if (sane) {
 				// Filename changed, and it was updated to something sane, update our target watch!
 				// NOTE: Forgo error checking, as this has already gone through an input validation pass.
+				//       Also, re-index it, as the registry is keyed on the filename.
+				unregister_watch(target_idx);
 				str5cpy(
 				    watchConfig[target_idx].filename, CFG_SZ_MAX, pconfig->filename, CFG_SZ_MAX, NOTRUNC);
+				register_watch(target_idx);
 				updated = true;
 				LOG(LOG_NOTICE,
-				    "Updated filename to '%s' for watch config @ index %hhu",
+				    "Updated filename to '%s' for watch config @ index %hu",
 				    watchConfig[target_idx].filename,
 				    target_idx);
 			}
@@ -618,7 +1121,7 @@ static bool
 			str5cpy(watchConfig[target_idx].action, CFG_SZ_MAX, pconfig->action, CFG_SZ_MAX, NOTRUNC);
 			updated = true;
 			LOG(LOG_NOTICE,
-			    "Updated action to '%s' for watch config @ index %hhu",
+			    "Updated action to '%s' for watch config @ index %hu",
 			    watchConfig[target_idx].action,
 			    target_idx);
 		}
@@ -629,7 +1132,7 @@ static bool
 		str5cpy(watchConfig[target_idx].label, CFG_SZ_MAX, pconfig->label, CFG_SZ_MAX, TRUNC);
 		updated = true;
 		LOG(LOG_NOTICE,
-		    "Updated label to '%s' for watch config @ index %hhu",
+		    "Updated label to '%s' for watch config @ index %hu",
 		    watchConfig[target_idx].label,
 		    target_idx);
 	}
@@ -639,7 +1142,7 @@ static bool
 		watchConfig[target_idx].hidden = pconfig->hidden;
 		updated                        = true;
 		LOG(LOG_NOTICE,
-		    "Updated hidden to %d for watch config @ index %hhu",
+		    "Updated hidden to %d for watch config @ index %hu",
 		    watchConfig[target_idx].hidden,
 		    target_idx);
 	}
@@ -648,8 +1151,9 @@ static bool
 	if (pconfig->block_spawns != watchConfig[target_idx].block_spawns) {
 		watchConfig[target_idx].block_spawns = pconfig->block_spawns;
 		updated                              = true;
+		update_spawn_blocker(target_idx);
 		LOG(LOG_NOTICE,
-		    "Updated block_spawns to %d for watch config @ index %hhu",
+		    "Updated block_spawns to %d for watch config @ index %hu",
 		    watchConfig[target_idx].block_spawns,
 		    target_idx);
 	}
@@ -659,7 +1163,7 @@ static bool
 		watchConfig[target_idx].skip_db_checks = pconfig->skip_db_checks;
 		updated                                = true;
 		LOG(LOG_NOTICE,
-		    "Updated skip_db_checks to %d for watch config @ index %hhu",
+		    "Updated skip_db_checks to %d for watch config @ index %hu",
 		    watchConfig[target_idx].skip_db_checks,
 		    target_idx);
 	}
@@ -669,22 +1173,49 @@ static bool
 		watchConfig[target_idx].do_db_update = pconfig->do_db_update;
 		updated                              = true;
 		LOG(LOG_NOTICE,
-		    "Updated do_db_update to %d for watch config @ index %hhu",
+		    "Updated do_db_update to %d for watch config @ index %hu",
 		    watchConfig[target_idx].do_db_update,
 		    target_idx);
 	}
 
-	// If we asked for a database update, the next three keys become mandatory
-	if (pconfig->do_db_update) {
-		if (pconfig->db_title[0] == '\0') {
-			LOG(LOG_CRIT, "Mandatory key 'db_title' is missing or blank!");
-			sane = false;
-		} else {
-			if (strcmp(pconfig->db_title, watchConfig[target_idx].db_title) != 0) {
-				str5cpy(watchConfig[target_idx].db_title, DB_SZ_MAX, pconfig->db_title, DB_SZ_MAX, TRUNC);
-				updated = true;
+	// Check if pending_timeout was updated...
+	if (pconfig->pending_timeout != watchConfig[target_idx].pending_timeout) {
+		watchConfig[target_idx].pending_timeout = pconfig->pending_timeout;
+		updated                                 = true;
+		LOG(LOG_NOTICE,
+		    "Updated pending_timeout to %hu for watch config @ index %hu",
+		    watchConfig[target_idx].pending_timeout,
+		    target_idx);
+	}
+
+	// Check if settle_delay was updated...
+	if (pconfig->settle_delay != watchConfig[target_idx].settle_delay) {
+		watchConfig[target_idx].settle_delay = pconfig->settle_delay;
+		updated                              = true;
+		LOG(LOG_NOTICE,
+		    "Updated settle_delay to %hu for watch config @ index %hu",
+		    watchConfig[target_idx].settle_delay,
+		    target_idx);
+	}
+
+	// Check if any of the spawn policy keys were updated...
+	if (!is_same_spawn_policy(&pconfig->policy, &watchConfig[target_idx].policy)) {
+		watchConfig[target_idx].policy = pconfig->policy;
+		updated                        = true;
+		LOG(LOG_NOTICE, "Updated the spawn policy for watch config @ index %hu", target_idx);
+	}
+
+	// If we asked for a database update, the next three keys become mandatory
+	if (pconfig->do_db_update) {
+		if (pconfig->db_title[0] == '\0') {
+			LOG(LOG_CRIT, "Mandatory key 'db_title' is missing or blank!");
+			sane = false;
+		} else {
+			if (strcmp(pconfig->db_title, watchConfig[target_idx].db_title) != 0) {
+				str5cpy(watchConfig[target_idx].db_title, DB_SZ_MAX, pconfig->db_title, DB_SZ_MAX, TRUNC);
+				updated = true;
 				LOG(LOG_NOTICE,
-				    "Updated db_title to '%s' for watch config @ index %hhu",
+				    "Updated db_title to '%s' for watch config @ index %hu",
 				    watchConfig[target_idx].db_title,
 				    target_idx);
 			}
@@ -698,7 +1229,7 @@ static bool
 				    watchConfig[target_idx].db_author, DB_SZ_MAX, pconfig->db_author, DB_SZ_MAX, TRUNC);
 				updated = true;
 				LOG(LOG_NOTICE,
-				    "Updated db_author to '%s' for watch config @ index %hhu",
+				    "Updated db_author to '%s' for watch config @ index %hu",
 				    watchConfig[target_idx].db_author,
 				    target_idx);
 			}
@@ -712,7 +1243,7 @@ static bool
 				    watchConfig[target_idx].db_comment, DB_SZ_MAX, pconfig->db_comment, DB_SZ_MAX, TRUNC);
 				updated = true;
 				LOG(LOG_NOTICE,
-				    "Updated db_comment to '%s' for watch config @ index %hhu",
+				    "Updated db_comment to '%s' for watch config @ index %hu",
 				    watchConfig[target_idx].db_comment,
 				    target_idx);
 			}
@@ -720,6 +1251,9 @@ static bool
 	}
 
 	if (sane && updated) {
+		// Forget what we knew about its DB entry, it may not be relevant anymore (e.g., new filename).
+		watchConfig[target_idx].db_cache = (const DbVerdict){ 0 };
+
 		fbink_printf(FBFD_AUTO,
 			     NULL,
 			     &fbinkConfig,
@@ -732,18 +1266,298 @@ static bool
 	return sane;
 }
 
-// Returns the index of the first usable entry in the watch list
-static int8_t
+// Returns the index of the first usable entry in the watch list, growing it if need be
+static int32_t
     get_next_available_watch_entry(void)
 {
-	for (uint8_t watch_idx = 0U; watch_idx < WATCH_MAX; watch_idx++) {
+	for (uint16_t watch_idx = 0U; watch_idx < watchListSize; watch_idx++) {
 		if (!watchConfig[watch_idx].is_active) {
-			return (int8_t) watch_idx;
+			return (int32_t) watch_idx;
+		}
+	}
+
+	// Everything's in use, make some room
+	uint16_t watch_idx = watchListSize;
+	if (!grow_watch_list()) {
+		return -1;
+	}
+	return (int32_t) watch_idx;
+}
+
+// Double the size of the watch list (and of its registry)
+// NOTE: This moves the watch list around, so, never keep a pointer to a watch across a call to this!
+//       Thankfully, the main thread is the only one that ever touches watchConfig directly (c.f., DbJob).
+static bool
+    grow_watch_list(void)
+{
+	if (watchListSize >= WATCH_MAX) {
+		return false;
+	}
+	uint16_t new_size = (uint16_t) MIN((uint32_t) WATCH_MAX, MAX(WATCH_MIN, watchListSize * 2U));
+	// NOTE: Do that one first, so that it's never smaller than the watch list, even if we fail halfway through.
+	if (!grow_pt_watch_slots(new_size)) {
+		return false;
+	}
+	WatchConfig* new_list = realloc(watchConfig, new_size * sizeof(*new_list));
+	if (new_list == NULL) {
+		PFLOG(LOG_ERR, "realloc: %m");
+		return false;
+	}
+	// Zero the new slots, which is what marks them as available
+	memset(new_list + watchListSize, 0, (size_t) (new_size - watchListSize) * sizeof(*new_list));
+	watchConfig   = new_list;
+	watchListSize = new_size;
+
+	// Keep the registry at (at least) four times that size, rounded up to a power of two
+	uint32_t registry_size = WATCH_MIN * 4U;
+	while (registry_size < (uint32_t) new_size * 4U) {
+		registry_size <<= 1U;
+	}
+	return resize_watch_registry(registry_size);
+}
+
+// FNV-1a, which is more than enough for our short paths
+static uint32_t
+    hash_watch_str(const char* str)
+{
+	uint32_t h = 2166136261U;
+	for (const unsigned char* c = (const unsigned char*) str; *c; c++) {
+		h ^= *c;
+		h *= 16777619U;
+	}
+	return h;
+}
+
+// Hash the lookup key of a given kind (only one of wd & str is relevant, depending on the key)
+static uint32_t
+    hash_watch_key(WatchKeyId key, int wd, const char* str)
+{
+	if (key == WATCH_KEY_WD || key == WATCH_KEY_THUMBS_WD) {
+		// Knuth's multiplicative hash, wds being small sequential integers, that's plenty
+		return (uint32_t) wd * 2654435761U;
+	}
+	return hash_watch_str(str);
+}
+
+// Does the watch stored at that index match the lookup key?
+static bool
+    watch_key_matches(WatchKeyId key, uint16_t watch_idx, int wd, const char* str)
+{
+	switch (key) {
+		case WATCH_KEY_WD:
+			return watchConfig[watch_idx].inotify_wd == wd;
+		case WATCH_KEY_FILENAME:
+			return strcmp(watchConfig[watch_idx].filename, str) == 0;
+		case WATCH_KEY_BASENAME:
+			return strcmp(get_watch_basename(watch_idx), str) == 0;
+		case WATCH_KEY_CONFIG:
+			return strcmp(watchConfig[watch_idx].config_name, str) == 0;
+		case WATCH_KEY_THUMBS_WD:
+			return watchConfig[watch_idx].thumbs.wd == wd;
+		default:
+			return false;
+	}
+}
+
+// Hash a watch's own key, as currently stored in its config
+static uint32_t
+    hash_watch_entry(WatchKeyId key, uint16_t watch_idx)
+{
+	switch (key) {
+		case WATCH_KEY_WD:
+			return hash_watch_key(key, watchConfig[watch_idx].inotify_wd, NULL);
+		case WATCH_KEY_FILENAME:
+			return hash_watch_key(key, 0, watchConfig[watch_idx].filename);
+		case WATCH_KEY_BASENAME:
+			return hash_watch_key(key, 0, get_watch_basename(watch_idx));
+		case WATCH_KEY_CONFIG:
+			return hash_watch_key(key, 0, watchConfig[watch_idx].config_name);
+		case WATCH_KEY_THUMBS_WD:
+			return hash_watch_key(key, watchConfig[watch_idx].thumbs.wd, NULL);
+		default:
+			return 0U;
+	}
+}
+
+static void
+    insert_watch_key(WatchKeyId key, uint16_t watch_idx)
+{
+	int32_t* restrict slots = watchRegistry.slots[key];
+	uint32_t          mask  = watchRegistry.size - 1U;
+	uint32_t          i     = hash_watch_entry(key, watch_idx) & mask;
+	// NOTE: Can't loop forever, as the table is always at least three quarters empty.
+	while (slots[i] != -1) {
+		i = (i + 1U) & mask;
+	}
+	slots[i] = (int32_t) watch_idx;
+}
+
+static int32_t
+    find_watch_key(WatchKeyId key, int wd, const char* str)
+{
+	const int32_t* restrict slots = watchRegistry.slots[key];
+	uint32_t                mask  = watchRegistry.size - 1U;
+	if (slots == NULL) {
+		return -1;
+	}
+
+	uint32_t i = hash_watch_key(key, wd, str) & mask;
+	while (slots[i] != -1) {
+		if (watch_key_matches(key, (uint16_t) slots[i], wd, str)) {
+			return slots[i];
 		}
+		i = (i + 1U) & mask;
 	}
 	return -1;
 }
 
+// NOTE: Must be called *before* the watch's key is modified, as that's what we use to find its slot.
+static void
+    erase_watch_key(WatchKeyId key, uint16_t watch_idx)
+{
+	int32_t* restrict slots = watchRegistry.slots[key];
+	uint32_t          mask  = watchRegistry.size - 1U;
+	uint32_t          i     = hash_watch_entry(key, watch_idx) & mask;
+	while (slots[i] != (int32_t) watch_idx) {
+		if (slots[i] == -1) {
+			// Not registered
+			return;
+		}
+		i = (i + 1U) & mask;
+	}
+
+	// Backward shift deletion, so that we never need tombstones:
+	// move any later entry of the same cluster whose home slot isn't between the hole and itself into the hole.
+	for (uint32_t j = (i + 1U) & mask; slots[j] != -1; j = (j + 1U) & mask) {
+		uint32_t home = hash_watch_entry(key, (uint16_t) slots[j]) & mask;
+		if (((j - home) & mask) >= ((j - i) & mask)) {
+			slots[i] = slots[j];
+			i        = j;
+		}
+	}
+	slots[i] = -1;
+}
+
+// (Re)allocate the registry's tables (size *must* be a power of two), and re-index every active watch
+static bool
+    resize_watch_registry(uint32_t size)
+{
+	for (uint8_t key = 0U; key < WATCH_KEY_COUNT; key++) {
+		int32_t* slots = realloc(watchRegistry.slots[key], size * sizeof(*slots));
+		if (slots == NULL) {
+			PFLOG(LOG_ERR, "realloc: %m");
+			return false;
+		}
+		memset(slots, -1, size * sizeof(*slots));
+		watchRegistry.slots[key] = slots;
+	}
+	watchRegistry.size = size;
+
+	for (uint16_t watch_idx = 0U; watch_idx < watchListSize; watch_idx++) {
+		if (watchConfig[watch_idx].is_active) {
+			register_watch(watch_idx);
+		}
+	}
+	return true;
+}
+
+// Index a freshly activated watch
+static void
+    register_watch(uint16_t watch_idx)
+{
+	const char* filename               = watchConfig[watch_idx].filename;
+	watchConfig[watch_idx].basename_ofs = (uint8_t) (basename(filename) - filename);
+
+	insert_watch_key(WATCH_KEY_FILENAME, watch_idx);
+	insert_watch_key(WATCH_KEY_BASENAME, watch_idx);
+	insert_watch_key(WATCH_KEY_CONFIG, watch_idx);
+	// NOTE: inotify never hands out a wd <= 0, and a fresh config has it zeroed.
+	if (watchConfig[watch_idx].inotify_wd > 0) {
+		insert_watch_key(WATCH_KEY_WD, watch_idx);
+	}
+	// NOTE: Only relevant when we're re-indexing everything (c.f., resize_watch_registry),
+	//       as a fresh watch isn't waiting on any thumbnails yet.
+	if (watchConfig[watch_idx].thumbs.wd > 0 && watchConfig[watch_idx].thumbs.prev == -1) {
+		insert_watch_key(WATCH_KEY_THUMBS_WD, watch_idx);
+	}
+}
+
+// Drop a watch from every index, and forget its state (before it's released or its filename is updated)
+static void
+    unregister_watch(uint16_t watch_idx)
+{
+	set_watch_state(watch_idx, WATCH_IDLE);
+
+	erase_watch_key(WATCH_KEY_FILENAME, watch_idx);
+	erase_watch_key(WATCH_KEY_BASENAME, watch_idx);
+	erase_watch_key(WATCH_KEY_CONFIG, watch_idx);
+	if (watchConfig[watch_idx].inotify_wd > 0) {
+		erase_watch_key(WATCH_KEY_WD, watch_idx);
+	}
+	// NOTE: Whatever we knew about its thumbnails won't be relevant anymore, either.
+	drop_thumbnail_watch(watch_idx);
+}
+
+// Update a watch's inotify wd (-1 meaning none), and its index entry
+static void
+    set_watch_wd(uint16_t watch_idx, int wd)
+{
+	if (watchConfig[watch_idx].inotify_wd > 0) {
+		erase_watch_key(WATCH_KEY_WD, watch_idx);
+	}
+	watchConfig[watch_idx].inotify_wd = wd;
+	if (wd > 0) {
+		insert_watch_key(WATCH_KEY_WD, watch_idx);
+	}
+}
+
+// Returns the index of the active watch with that inotify wd, or -1
+static int32_t
+    find_watch_by_wd(int wd)
+{
+	return find_watch_key(WATCH_KEY_WD, wd, NULL);
+}
+
+// Returns the index of the active watch on that file, or -1
+static int32_t
+    find_watch_by_filename(const char* filename)
+{
+	return find_watch_key(WATCH_KEY_FILENAME, 0, filename);
+}
+
+// Returns the index of the active watch on a file with that basename, or -1
+static int32_t
+    find_watch_by_basename(const char* name)
+{
+	return find_watch_key(WATCH_KEY_BASENAME, 0, name);
+}
+
+// Returns the index of the active watch loaded from that config file, or -1
+static int32_t
+    find_watch_by_config(const char* name)
+{
+	return find_watch_key(WATCH_KEY_CONFIG, 0, name);
+}
+
+// Remember which config file an active watch was (re)loaded from, and what it looked like at the time
+static void
+    set_watch_config_file(uint16_t watch_idx, const char* name, const FileStamp* stamp)
+{
+	if (strcmp(watchConfig[watch_idx].config_name, name) != 0) {
+		erase_watch_key(WATCH_KEY_CONFIG, watch_idx);
+		str5cpy(watchConfig[watch_idx].config_name, CFG_SZ_MAX, name, CFG_SZ_MAX, TRUNC);
+		insert_watch_key(WATCH_KEY_CONFIG, watch_idx);
+	}
+	watchConfig[watch_idx].config_stamp = *stamp;
+}
+
+// Returns the (cached) basename of a watch's filename
+static const char*
+    get_watch_basename(uint16_t watch_idx)
+{
+	return watchConfig[watch_idx].filename + watchConfig[watch_idx].basename_ofs;
+}
+
 // Mimic scandir's alphasort
 static int
     fts_alphasort(const FTSENT** a, const FTSENT** b)
@@ -795,7 +1609,7 @@ static int
 	// Until something goes wrong...
 	int rval = EXIT_SUCCESS;
 	// Keep track of how many watches we've set up
-	uint8_t watch_count = 0U;
+	uint16_t watch_count = 0U;
 
 	FTSENT* restrict p;
 	while ((p = fts_read(ftsp)) != NULL) {
@@ -821,11 +1635,15 @@ static int
 							rval = -1;
 						} else {
 							LOG(LOG_NOTICE,
-							    "Daemon config loaded from '%s': db_timeout=%hu, use_syslog=%d, with_notifications=%d",
+							    "Daemon config loaded from '%s': db_timeout=%hu, use_syslog=%d, with_notifications=%d, watch_thumbnails=%d, watch_directories=%d, use_fanotify=%d, use_zygote=%d",
 							    p->fts_name,
 							    daemonConfig.db_timeout,
 							    daemonConfig.use_syslog,
-							    daemonConfig.with_notifications);
+							    daemonConfig.with_notifications,
+							    daemonConfig.watch_thumbnails,
+							    daemonConfig.watch_directories,
+							    daemonConfig.use_fanotify,
+							    daemonConfig.use_zygote);
 						}
 					} else if (strcasecmp(p->fts_name, "kfmon.user.ini") == 0) {
 						// NOTE: Skip the user config for now,
@@ -833,9 +1651,9 @@ static int
 						//       and we need it to be parsed *after* the main daemon config.
 						continue;
 					} else {
-						// NOTE: Don't blow up when trying to store more watches than we have
-						//       space for...
-						if (watch_count >= WATCH_MAX) {
+						// NOTE: Make room if need be, but don't blow up
+						//       when trying to store more watches than we can ever handle...
+						if (watch_count >= watchListSize && !grow_watch_list()) {
 							LOG(LOG_WARNING,
 							    "We've already setup the maximum amount of watches we can handle (%d), discarding '%s'!",
 							    WATCH_MAX,
@@ -844,6 +1662,10 @@ static int
 							break;
 						}
 
+						// Snapshot it first, so we can tell whether it changed later on
+						FileStamp stamp;
+						get_file_stamp(p->fts_path, &stamp);
+
 						// Assume a config is invalid until proven otherwise...
 						bool is_watch_valid = false;
 						int  ret =
@@ -856,7 +1678,7 @@ static int
 						} else {
 							if (validate_watch_config(&watchConfig[watch_count])) {
 								LOG(LOG_NOTICE,
-								    "Watch config @ index %hhu loaded from '%s': filename=%s, action=%s, label=%s, hidden=%d, block_spawns=%d, do_db_update=%d, db_title=%s, db_author=%s, db_comment=%s",
+								    "Watch config @ index %hu loaded from '%s': filename=%s, action=%s, label=%s, hidden=%d, block_spawns=%d, do_db_update=%d, db_title=%s, db_author=%s, db_comment=%s, pending_timeout=%hu, settle_delay=%hu",
 								    watch_count,
 								    p->fts_name,
 								    watchConfig[watch_count].filename,
@@ -867,7 +1689,9 @@ static int
 								    watchConfig[watch_count].do_db_update,
 								    watchConfig[watch_count].db_title,
 								    watchConfig[watch_count].db_author,
-								    watchConfig[watch_count].db_comment);
+								    watchConfig[watch_count].db_comment,
+								    watchConfig[watch_count].pending_timeout,
+								    watchConfig[watch_count].settle_delay);
 
 								is_watch_valid = true;
 							} else {
@@ -879,7 +1703,9 @@ static int
 						// If the watch config is valid, mark it as active, and increment the active count.
 						// Otherwise, clear the slot so it can be reused.
 						if (is_watch_valid) {
-							watchConfig[watch_count++].is_active = true;
+							watchConfig[watch_count].is_active = true;
+							register_watch(watch_count);
+							set_watch_config_file(watch_count++, p->fts_name, &stamp);
 						} else {
 							watchConfig[watch_count] = (const WatchConfig){ 0 };
 						}
@@ -905,23 +1731,32 @@ static int
 			rval = -1;
 		} else {
 			LOG(LOG_NOTICE,
-			    "Daemon config loaded from '%s': db_timeout=%hu, use_syslog=%d, with_notifications=%d",
+			    "Daemon config loaded from '%s': db_timeout=%hu, use_syslog=%d, with_notifications=%d, watch_thumbnails=%d, watch_directories=%d, use_fanotify=%d, use_zygote=%d",
 			    "kfmon.user.ini",
 			    daemonConfig.db_timeout,
 			    daemonConfig.use_syslog,
-			    daemonConfig.with_notifications);
+			    daemonConfig.with_notifications,
+			    daemonConfig.watch_thumbnails,
+			    daemonConfig.watch_directories,
+			    daemonConfig.use_fanotify,
+			    daemonConfig.use_zygote);
 		}
 	}
 
 #ifdef DEBUG
 	// Let's recap (including failures)...
-	DBGLOG("Daemon config recap: db_timeout=%hu, use_syslog=%d, with_notifications=%d",
-	       daemonConfig.db_timeout,
-	       daemonConfig.use_syslog,
-	       daemonConfig.with_notifications);
-	for (uint8_t watch_idx = 0U; watch_idx < WATCH_MAX; watch_idx++) {
+	DBGLOG(
+	    "Daemon config recap: db_timeout=%hu, use_syslog=%d, with_notifications=%d, watch_thumbnails=%d, watch_directories=%d, use_fanotify=%d, use_zygote=%d",
+	    daemonConfig.db_timeout,
+	    daemonConfig.use_syslog,
+	    daemonConfig.with_notifications,
+	    daemonConfig.watch_thumbnails,
+	    daemonConfig.watch_directories,
+	    daemonConfig.use_fanotify,
+	    daemonConfig.use_zygote);
+	for (uint16_t watch_idx = 0U; watch_idx < watchListSize; watch_idx++) {
 		DBGLOG(
-		    "Watch config @ index %hhu recap: active=%d, filename=%s, action=%s, label=%s, hidden=%d, block_spawns=%d, skip_db_checks=%d, do_db_update=%d, db_title=%s, db_author=%s, db_comment=%s",
+		    "Watch config @ index %hu recap: active=%d, filename=%s, action=%s, label=%s, hidden=%d, block_spawns=%d, skip_db_checks=%d, do_db_update=%d, db_title=%s, db_author=%s, db_comment=%s, pending_timeout=%hu, settle_delay=%hu",
 		    watch_idx,
 		    watchConfig[watch_idx].is_active,
 		    watchConfig[watch_idx].filename,
@@ -933,7 +1768,9 @@ static int
 		    watchConfig[watch_idx].do_db_update,
 		    watchConfig[watch_idx].db_title,
 		    watchConfig[watch_idx].db_author,
-		    watchConfig[watch_idx].db_comment);
+		    watchConfig[watch_idx].db_comment,
+		    watchConfig[watch_idx].pending_timeout,
+		    watchConfig[watch_idx].settle_delay);
 	}
 #endif
 
@@ -973,9 +1810,15 @@ static int
 	}
 
 	// Keep track of which watch indexes are up-to-date, so we can drop stale watches if some configs were deleted.
-	// NOTE: Init to -1 because 0 is a valid watch index ;).
-	int8_t  new_watch_list[] = { [0 ... WATCH_MAX - 1] = -1 };
-	uint8_t new_watch_count  = 0U;
+	// NOTE: Only the slots that exist right now can go stale,
+	//       anything past that (if the list grows) can only be a brand new watch ;).
+	uint16_t seen_size = watchListSize;
+	bool*    seen      = calloc(seen_size, sizeof(*seen));
+	if (seen == NULL) {
+		PFLOG(LOG_ERR, "calloc: %m");
+		fts_close(ftsp);
+		return -1;
+	}
 	// If there was a meaningful update, we'll update the IPC socket's mtime as a hint to clients that new data is available.
 	bool notify_update = false;
 
@@ -997,6 +1840,28 @@ static int
 					} else if (strcasecmp(p->fts_name, "kfmon.user.ini") == 0) {
 						continue;
 					} else {
+						// NOTE: Snapshot it first, so that anything that happens
+						//       while we parse it can only make us err on the side of caution.
+						FileStamp stamp;
+						bool      has_stamp = get_file_stamp(p->fts_path, &stamp);
+						// When coming back from an export, skip the ones that didn't change
+						// since we last loaded them.
+						if (daemonState == DAEMON_RESUMING && has_stamp) {
+							int32_t match = find_watch_by_config(p->fts_name);
+							if (match >= 0 &&
+							    is_same_file_stamp(&stamp,
+									       &watchConfig[match].config_stamp)) {
+								LOG(LOG_INFO,
+								    "Watch config file '%s' is unchanged, keeping watch idx %d as-is",
+								    p->fts_path,
+								    match);
+								if (match < seen_size) {
+									seen[match] = true;
+								}
+								continue;
+							}
+						}
+
 						LOG(LOG_INFO,
 						    "Checking watch config file '%s' for changes . . .",
 						    p->fts_path);
@@ -1013,26 +1878,14 @@ static int
 							    ret);
 						} else {
 							// Try to match it to a current watch, based on the trigger file...
-							uint8_t watch_idx    = 0U;
-							bool    is_new_watch = true;
-							for (watch_idx = 0U; watch_idx < WATCH_MAX; watch_idx++) {
-								// Only check active watches
-								if (!watchConfig[watch_idx].is_active) {
-									continue;
-								}
-
-								if (strcmp(cur_watch.filename,
-									   watchConfig[watch_idx].filename) == 0) {
-									// Gotcha!
-									is_new_watch = false;
-									// And we're good!
-									break;
-								}
-							}
+							int32_t  match =
+							    find_watch_by_filename(cur_watch.filename);
+							bool     is_new_watch = (match < 0);
+							uint16_t watch_idx    = is_new_watch ? 0U : (uint16_t) match;
 
 							if (is_new_watch) {
 								// New watch! Make it so!
-								int8_t new_watch_idx = get_next_available_watch_entry();
+								int32_t new_watch_idx = get_next_available_watch_entry();
 								if (new_watch_idx < 0) {
 									// Discard it if we already have the maximum amount of watches set up
 									LOG(LOG_WARNING,
@@ -1040,13 +1893,13 @@ static int
 									    p->fts_name,
 									    WATCH_MAX);
 								} else {
-									watch_idx              = (uint8_t) new_watch_idx;
+									watch_idx              = (uint16_t) new_watch_idx;
 									watchConfig[watch_idx] = cur_watch;
 
 									if (validate_watch_config(
 										&watchConfig[watch_idx])) {
 										LOG(LOG_NOTICE,
-										    "Watch config @ index %hhu loaded from '%s': filename=%s, action=%s, label=%s, hidden=%d, block_spawns=%d, do_db_update=%d, db_title=%s, db_author=%s, db_comment=%s",
+										    "Watch config @ index %hu loaded from '%s': filename=%s, action=%s, label=%s, hidden=%d, block_spawns=%d, do_db_update=%d, db_title=%s, db_author=%s, db_comment=%s, pending_timeout=%hu, settle_delay=%hu",
 										    watch_idx,
 										    p->fts_name,
 										    watchConfig[watch_idx].filename,
@@ -1057,12 +1910,19 @@ static int
 										    watchConfig[watch_idx].do_db_update,
 										    watchConfig[watch_idx].db_title,
 										    watchConfig[watch_idx].db_author,
-										    watchConfig[watch_idx].db_comment);
+										    watchConfig[watch_idx].db_comment,
+										    watchConfig[watch_idx].pending_timeout,
+										    watchConfig[watch_idx].settle_delay);
 
 										// Flag it as active
 										watchConfig[watch_idx].is_active = true;
-										new_watch_list[new_watch_count++] =
-										    (int8_t) watch_idx;
+										register_watch(watch_idx);
+										update_spawn_blocker(watch_idx);
+										set_watch_config_file(
+										    watch_idx, p->fts_name, &stamp);
+										if (watch_idx < seen_size) {
+											seen[watch_idx] = true;
+										}
 
 										fbink_printf(
 										    FBFD_AUTO,
@@ -1086,22 +1946,21 @@ static int
 								}
 							} else {
 								// Updated watch!
-								pthread_mutex_lock(&ptlock);
 								bool is_watch_spawned =
 								    is_watch_already_spawned(watch_idx);
-								pthread_mutex_unlock(&ptlock);
 								// Don't do anything if it's already running...
 								if (is_watch_spawned) {
 									LOG(LOG_INFO,
-									    "Cannot update watch slot %hhu (%s => %s), as it's currently running! Discarding potentially new data from '%s'!",
+									    "Cannot update watch slot %hu (%s => %s), as it's currently running! Discarding potentially new data from '%s'!",
 									    watch_idx,
 									    basename(watchConfig[watch_idx].filename),
 									    basename(watchConfig[watch_idx].action),
 									    p->fts_name);
 
 									// Don't forget to flag it as a keeper...
-									new_watch_list[new_watch_count++] =
-									    (int8_t) watch_idx;
+									if (watch_idx < seen_size) {
+										seen[watch_idx] = true;
+									}
 								} else {
 									bool was_updated = false;
 									// Validate what was parsed, and merge it if it's sane!
@@ -1109,8 +1968,11 @@ static int
 										&cur_watch, watch_idx, &was_updated)) {
 										// NOTE: validate_and_merge takes care of both
 										//       logging and updating the watch data
-										new_watch_list[new_watch_count++] =
-										    (int8_t) watch_idx;
+										if (watch_idx < seen_size) {
+											seen[watch_idx] = true;
+										}
+										set_watch_config_file(
+										    watch_idx, p->fts_name, &stamp);
 
 										// Updated stuff!
 										if (was_updated) {
@@ -1132,10 +1994,13 @@ static int
 
 										// Don't keep the previous state around,
 										// clear the slot.
+										disarm_watch(watch_idx);
+										unregister_watch(watch_idx);
 										watchConfig[watch_idx] =
 										    (const WatchConfig){ 0 };
+										update_spawn_blocker(watch_idx);
 										LOG(LOG_NOTICE,
-										    "Released watch slot %hhu.",
+										    "Released watch slot %hu.",
 										    watch_idx);
 
 										// Less stuff!
@@ -1155,25 +2020,16 @@ static int
 
 	// Purge stale watch entries (in case a config has been deleted, but not its watched file;
 	// or if an existing config file was updated, but failed to pass watch_handler @ ini_parse).
-	for (uint8_t watch_idx = 0U; watch_idx < WATCH_MAX; watch_idx++) {
+	for (uint16_t watch_idx = 0U; watch_idx < seen_size; watch_idx++) {
 		// It of course needs to be active first so it can potentially be stale ;)
 		if (!watchConfig[watch_idx].is_active) {
 			continue;
 		}
 
 		// Is that active entry stale (i.e., we couldn't find its config file)?
-		bool keep = false;
-		for (uint8_t i = 0U; i < WATCH_MAX; i++) {
-			if ((int8_t) watch_idx == new_watch_list[i]) {
-				keep = true;
-				break;
-			}
-		}
-
-		// It's stale, drop it now
-		if (!keep) {
+		if (!seen[watch_idx]) {
 			LOG(LOG_WARNING,
-			    "Watch config @ index %hhu (%s => %s) is still active, but its config file is either gone or broken! Discarding it!",
+			    "Watch config @ index %hu (%s => %s) is still active, but its config file is either gone or broken! Discarding it!",
 			    watch_idx,
 			    basename(watchConfig[watch_idx].filename),
 			    basename(watchConfig[watch_idx].action));
@@ -1184,13 +2040,17 @@ static int
 				     "[KFMon] Dropped the watch on %s!",
 				     basename(watchConfig[watch_idx].filename));
 
+			disarm_watch(watch_idx);
+			unregister_watch(watch_idx);
 			watchConfig[watch_idx] = (const WatchConfig){ 0 };
-			LOG(LOG_NOTICE, "Released watch slot %hhu.", watch_idx);
+			update_spawn_blocker(watch_idx);
+			LOG(LOG_NOTICE, "Released watch slot %hu.", watch_idx);
 
 			// Stale stuff!
 			notify_update = true;
 		}
 	}
+	free(seen);
 
 	// There were meaningful updates, update the IPC socket's mtime!
 	if (notify_update) {
@@ -1203,9 +2063,9 @@ static int
 
 #ifdef DEBUG
 	// Let's recap (including failures)...
-	for (uint8_t watch_idx = 0U; watch_idx < WATCH_MAX; watch_idx++) {
+	for (uint16_t watch_idx = 0U; watch_idx < watchListSize; watch_idx++) {
 		DBGLOG(
-		    "Watch config @ index %hhu recap: active=%d, filename=%s, action=%s, label=%s, hidden=%d, block_spawns=%d, skip_db_checks=%d, do_db_update=%d, db_title=%s, db_author=%s, db_comment=%s",
+		    "Watch config @ index %hu recap: active=%d, filename=%s, action=%s, label=%s, hidden=%d, block_spawns=%d, skip_db_checks=%d, do_db_update=%d, db_title=%s, db_author=%s, db_comment=%s, pending_timeout=%hu, settle_delay=%hu",
 		    watch_idx,
 		    watchConfig[watch_idx].is_active,
 		    watchConfig[watch_idx].filename,
@@ -1217,7 +2077,9 @@ static int
 		    watchConfig[watch_idx].do_db_update,
 		    watchConfig[watch_idx].db_title,
 		    watchConfig[watch_idx].db_author,
-		    watchConfig[watch_idx].db_comment);
+		    watchConfig[watch_idx].db_comment,
+		    watchConfig[watch_idx].pending_timeout,
+		    watchConfig[watch_idx].settle_delay);
 	}
 #endif
 
@@ -1240,228 +2102,488 @@ static unsigned int
 	return h;
 }
 
-// Check if our target file has been processed by Nickel...
-static bool
-    is_target_processed(uint8_t watch_idx, bool wait_for_db)
+// Open (if need be) & return one of our long-lived connections to Nickel's DB (read-only unless rw is true)
+static sqlite3*
+    get_kobo_db(bool rw)
 {
-#ifdef DEBUG
-	// Bypass DB checks on demand for debugging purposes...
-	if (watchConfig[watch_idx].skip_db_checks)
-		return true;
-#endif
+	// If the DB file isn't the one we opened anymore (e.g., the mountpoint was cycled, or Nickel rebuilt its DB),
+	// drop our stale connections, and start afresh.
+	// NOTE: That's a single stat, which is still much cheaper than opening the DB & parsing its schema ;).
+	struct stat st;
+	if (stat(KOBO_DB_PATH, &st) == -1) {
+		PFLOG(LOG_WARNING, "stat: %m");
+		close_kobo_db();
+		return NULL;
+	}
+	if ((DBC.ro_db || DBC.rw_db) && (st.st_dev != DBC.db_dev || st.st_ino != DBC.db_ino)) {
+		LOG(LOG_NOTICE, "Nickel's DB changed underneath us, reopening it");
+		close_kobo_db();
+	}
+	DBC.db_dev = st.st_dev;
+	DBC.db_ino = st.st_ino;
 
-	// Did the user want to try to update the DB for this icon?
-	bool update       = watchConfig[watch_idx].do_db_update;
-	bool is_processed = false;
-	bool needs_update = false;
+	sqlite3** db = rw ? &DBC.rw_db : &DBC.ro_db;
+	if (*db) {
+		return *db;
+	}
 
 	// NOTE: Open the db in single-thread threading mode (we build w/o threadsafe),
-	//       and without a shared cache: we only do SQL from the main thread.
-	sqlite3* db;
-	if (update) {
-		CALL_SQLITE(open_v2(
-		    KOBO_DB_PATH, &db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_NOMUTEX | SQLITE_OPEN_PRIVATECACHE, NULL));
-	} else {
-		// Open the DB ro to be extra-safe...
-		CALL_SQLITE(open_v2(
-		    KOBO_DB_PATH, &db, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX | SQLITE_OPEN_PRIVATECACHE, NULL));
-	}
-
-	// Wait at most for Nms on OPEN & N*2ms on CLOSE if we ever hit a locked database during any of our proceedings.
-	// NOTE: The defaults timings (steps of 500ms) appear to work reasonably well on my H2O with a 50MB Nickel DB...
-	//       (i.e., it trips on OPEN when Nickel is moderately busy, but if everything's quiet, we're good).
-	//       Time will tell if that's a good middle-ground or not ;).
-	//       This is user configurable in kfmon.ini (db_timeout key).
-	// NOTE: On current FW versions, where the DB is now using WAL, we're exceedingly unlikely to ever hit a BUSY DB
-	//       (c.f., https://www.sqlite.org/wal.html)
-	sqlite3_busy_timeout(db, (int) daemonConfig.db_timeout * (wait_for_db + 1));
-	DBGLOG("SQLite busy timeout set to %dms", (int) daemonConfig.db_timeout * (wait_for_db + 1));
+	//       and without a shared cache: we only ever do SQL from the DB worker thread.
+	//       Open it ro unless we actually need to write to it, to be extra-safe...
+	int flags = (rw ? SQLITE_OPEN_READWRITE : SQLITE_OPEN_READONLY) | SQLITE_OPEN_NOMUTEX | SQLITE_OPEN_PRIVATECACHE;
+	int rc    = sqlite3_open_v2(KOBO_DB_PATH, db, flags, NULL);
+	if (rc != SQLITE_OK) {
+		LOG(LOG_CRIT, "open_v2 failed with status %d: %s", rc, sqlite3_errmsg(*db));
+		// NOTE: A handle is allocated even on failure, so make sure it doesn't leak.
+		sqlite3_close(*db);
+		*db = NULL;
+		return NULL;
+	}
+	LOG(LOG_INFO, "Opened a %s connection to Nickel's DB", rw ? "read-write" : "read-only");
+	if (!rw) {
+		// Invalidate every DbVerdict computed on the previous connection
+		DBC.generation++;
+	}
 
+	return *db;
+}
+
+// Return the cached prepared statement for a given query, preparing it on the right connection first if need be
+static sqlite3_stmt*
+    get_db_stmt(DbStmtId id)
+{
 	// NOTE: ContentType 6 should mean a book on pretty much anything since FW 1.9.17 (and why a book?
 	//       Because Nickel currently identifies single PNGs as application/x-cbz, bless its cute little bytes).
-	sqlite3_stmt* stmt;
-	CALL_SQLITE(prepare_v2(
-	    db, "SELECT EXISTS(SELECT 1 FROM content WHERE ContentID = @id AND ContentType = '6');", -1, &stmt, NULL));
+	static const char* const queries[DB_STMT_COUNT] = {
+		[DB_STMT_CONTENT] = "SELECT ImageID, Title FROM content WHERE ContentID = @id AND ContentType = '6' LIMIT 1;",
+		[DB_STMT_DATA_VERSION] = "PRAGMA data_version;",
+		[DB_STMT_UPDATE] =
+		    "UPDATE content SET Title = @title, Attribution = @author, Description = @comment WHERE ContentID = @id AND ContentType = '6';",
+	};
 
-	// Append the proper URI scheme to our icon path...
-	char book_path[CFG_SZ_MAX + 7];
-	snprintf(book_path, sizeof(book_path), "file://%s", watchConfig[watch_idx].filename);
+	if (DBC.stmts[id]) {
+		return DBC.stmts[id];
+	}
 
-	int idx = sqlite3_bind_parameter_index(stmt, "@id");
-	CALL_SQLITE(bind_text(stmt, idx, book_path, -1, SQLITE_STATIC));
+	sqlite3* db = get_kobo_db(id == DB_STMT_UPDATE);
+	if (!db) {
+		return NULL;
+	}
 
-	int rc = sqlite3_step(stmt);
-	if (rc == SQLITE_ROW) {
-		DBGLOG("SELECT SQL query returned: %d", sqlite3_column_int(stmt, 0));
-		if (sqlite3_column_int(stmt, 0) == 1) {
-			is_processed = true;
-		}
+	// NOTE: We'll be reusing these for as long as the connection lives, so, let SQLite know about it.
+	int rc = sqlite3_prepare_v3(db, queries[id], -1, SQLITE_PREPARE_PERSISTENT, &DBC.stmts[id], NULL);
+	if (rc != SQLITE_OK) {
+		LOG(LOG_CRIT, "prepare_v3 failed with status %d: %s", rc, sqlite3_errmsg(db));
+		DBC.stmts[id] = NULL;
+		return NULL;
 	}
 
-	sqlite3_finalize(stmt);
+	return DBC.stmts[id];
+}
 
-	// NOTE: If the file doesn't appear to have been processed by Nickel yet, despite clearly existing on the FS,
-	//       since we got an inotify event from it, see if there isn't a case issue in the filename specified in the .ini...
-	//       (FAT32 is case-insensitive, but we make a case sensitive SQL query, because it's much faster!)
-	// NOTE: This works, but is commented out,
-	//       because it's a massive performance sink for what's essentially a very minor QOL fix for a PEBCAK...
-	/*
-	if (!is_processed) {
-		bool broken_case = false;
+// Reset a cached statement, so it's ready to be rebound on the next check.
+// NOTE: This is *mandatory* as soon as we're done stepping,
+//       as a statement that hasn't been reset keeps its read transaction open,
+//       which would prevent Nickel from checkpointing the WAL!
+static void
+    release_db_stmt(sqlite3_stmt* stmt)
+{
+	sqlite3_reset(stmt);
+	sqlite3_clear_bindings(stmt);
+}
 
-		CALL_SQLITE(prepare_v2(
-		    db,
-		    "SELECT EXISTS(SELECT 1 FROM content WHERE ContentID = @id COLLATE NOCASE AND ContentType = '6');",
-		    -1,
-		    &stmt,
-		    NULL));
-		idx = sqlite3_bind_parameter_index(stmt, "@id");
-		CALL_SQLITE(bind_text(stmt, idx, book_path, -1, SQLITE_STATIC));
+// Finalize our cached statements, and close our DB connections
+static void
+    close_kobo_db(void)
+{
+	for (uint8_t i = 0U; i < DB_STMT_COUNT; i++) {
+		sqlite3_finalize(DBC.stmts[i]);
+		DBC.stmts[i] = NULL;
+	}
 
-		rc = sqlite3_step(stmt);
-		if (rc == SQLITE_ROW) {
-			DBGLOG("SELECT SQL query returned: %d", sqlite3_column_int(stmt, 0));
-			if (sqlite3_column_int(stmt, 0) == 1) {
-				is_processed = true;
-				broken_case  = true;
-			}
-		}
+	if (DBC.ro_db) {
+		sqlite3_close(DBC.ro_db);
+		DBC.ro_db = NULL;
+		LOG(LOG_INFO, "Closed our read-only connection to Nickel's DB");
+	}
+	if (DBC.rw_db) {
+		sqlite3_close(DBC.rw_db);
+		DBC.rw_db = NULL;
+		LOG(LOG_INFO, "Closed our read-write connection to Nickel's DB");
+	}
+}
 
-		sqlite3_finalize(stmt);
+// Returns the current data_version of our read-only connection, or -1 on failure.
+// It changes whenever *another* connection (be it Nickel's or our own read-write one) commits something to the DB,
+// c.f., https://www.sqlite.org/pragma.html#pragma_data_version
+static int64_t
+    get_db_data_version(void)
+{
+	sqlite3_stmt* stmt = get_db_stmt(DB_STMT_DATA_VERSION);
+	if (!stmt) {
+		return -1;
+	}
 
-		// If the case-insensitive query worked, do yet another query to log the expected filename...
-		if (broken_case) {
-			CALL_SQLITE(prepare_v2(
-			    db,
-			    "SELECT ContentID FROM content WHERE ContentID = @id COLLATE NOCASE AND ContentType = '6';",
-			    -1,
-			    &stmt,
-			    NULL));
-			idx = sqlite3_bind_parameter_index(stmt, "@id");
-			CALL_SQLITE(bind_text(stmt, idx, book_path, -1, SQLITE_STATIC));
+	int64_t data_version = -1;
+	if (sqlite3_step(stmt) == SQLITE_ROW) {
+		data_version = sqlite3_column_int64(stmt, 0);
+	}
+	release_db_stmt(stmt);
 
-			rc = sqlite3_step(stmt);
-			if (rc == SQLITE_ROW) {
-				// Warn, and update book_path, so we don't have to do any more slow case-insensitive queries...
-				snprintf(book_path, sizeof(book_path), "%s", sqlite3_column_text(stmt, 0));
-				DBGLOG("SELECT SQL query returned: %s", book_path);
-				LOG(LOG_WARNING,
-				    "Watch config @ index %hhu has a filename field with broken case (%s -> %s)!",
-				    watch_idx,
-				    watchConfig[watch_idx].filename,
-				    book_path + 7);
-			}
+	return data_version;
+}
 
-			sqlite3_finalize(stmt);
-		}
-	}
-	*/
+// Wait at most for Nms on OPEN & N*2ms on CLOSE if we ever hit a locked database during any of our proceedings.
+// NOTE: The defaults timings (steps of 500ms) appear to work reasonably well on my H2O with a 50MB Nickel DB...
+//       (i.e., it trips on OPEN when Nickel is moderately busy, but if everything's quiet, we're good).
+//       Time will tell if that's a good middle-ground or not ;).
+//       This is user configurable in kfmon.ini (db_timeout key).
+// NOTE: On current FW versions, where the DB is now using WAL, we're exceedingly unlikely to ever hit a BUSY DB
+//       (c.f., https://www.sqlite.org/wal.html)
+static void
+    set_db_busy_timeout(sqlite3* db, bool wait_for_db)
+{
+	sqlite3_busy_timeout(db, (int) daemonConfig.db_timeout * (wait_for_db + 1));
+	DBGLOG("SQLite busy timeout set to %dms", (int) daemonConfig.db_timeout * (wait_for_db + 1));
+}
 
-	// Now that we know the book exists, we also want to check if the thumbnails do,
-	// to avoid getting triggered from the thumbnail creation...
-	// NOTE: Again, this assumes FW >= 2.9.0
-	if (is_processed) {
-		// Assume they haven't been processed until we can confirm it...
-		is_processed = false;
+// Build the path to the (sharded) directory where Nickel stores the thumbnails for a given ImageID
+static void
+    get_images_path(const char* image_id, char* images_path, size_t len)
+{
+	// We need the proper hashes Nickel devises...
+	// c.f., images_path @
+	// https://github.com/kovidgoyal/calibre/blob/205754891e341e7f940e70057ac3a96a2443fdbd/src/calibre/devices/kobo/driver.py#L2584-L2600
+	unsigned int hash = qhash((const unsigned char*) image_id, strlen(image_id));
+	unsigned int dir1 = hash & (0xff * 1);
+	unsigned int dir2 = (hash & (0xff00 * 1)) >> 8;
+
+	int ret = snprintf(images_path, len, "%s/.kobo-images/%u/%u", KFMON_TARGET_MOUNTPOINT, dir1, dir2);
+	if (ret < 0 || (size_t) ret >= len) {
+		LOG(LOG_WARNING, "Couldn't build the image path string!");
+	}
+}
 
-		// We'll need the ImageID first...
-		CALL_SQLITE(prepare_v2(
-		    db, "SELECT ImageID FROM content WHERE ContentID = @id AND ContentType = '6';", -1, &stmt, NULL));
+// Check if Nickel has generated all three thumbnails for a given ImageID
+static bool
+    are_thumbnails_processed(const char* image_id)
+{
+	char images_path[KFMON_PATH_MAX];
+	get_images_path(image_id, images_path, sizeof(images_path));
+	DBGLOG("Checking for thumbnails in '%s' . . .", images_path);
+
+	// Count the number of processed thumbnails we find...
+	uint8_t thumbnails_count = 0U;
+	char    thumbnail_path[KFMON_PATH_MAX];
+
+	// Start with the full-size screensaver...
+	int ret = snprintf(thumbnail_path, sizeof(thumbnail_path), "%s/%s - N3_FULL.parsed", images_path, image_id);
+	if (ret < 0 || (size_t) ret >= sizeof(thumbnail_path)) {
+		LOG(LOG_WARNING, "Couldn't build the thumbnail path string!");
+	}
+	DBGLOG("Checking for full-size screensaver '%s' . . .", thumbnail_path);
+	if (access(thumbnail_path, F_OK) == 0) {
+		thumbnails_count++;
+	} else {
+		LOG(LOG_INFO, "Full-size screensaver hasn't been parsed yet!");
+	}
 
-		idx = sqlite3_bind_parameter_index(stmt, "@id");
-		CALL_SQLITE(bind_text(stmt, idx, book_path, -1, SQLITE_STATIC));
+	// Then the Homescreen tile...
+	// NOTE: This one might be a tad confusing...
+	//       If the icon has never been processed,
+	//       this will only happen the first time we *close* the PNG's "book"...
+	//       (i.e., the moment it pops up as the 'last opened' tile).
+	//       And *that* processing triggers a set of OPEN & CLOSE,
+	//       meaning we can quite possibly run on book *exit* that first time,
+	//       (and only that first time), if database locking permits...
+	ret = snprintf(thumbnail_path, sizeof(thumbnail_path), "%s/%s - N3_LIBRARY_FULL.parsed", images_path, image_id);
+	if (ret < 0 || (size_t) ret >= sizeof(thumbnail_path)) {
+		LOG(LOG_WARNING, "Couldn't build the thumbnail path string!");
+	}
+	DBGLOG("Checking for homescreen tile '%s' . . .", thumbnail_path);
+	if (access(thumbnail_path, F_OK) == 0) {
+		thumbnails_count++;
+	} else {
+		LOG(LOG_INFO, "Homescreen tile hasn't been parsed yet!");
+	}
 
-		rc = sqlite3_step(stmt);
-		if (rc == SQLITE_ROW) {
-			const unsigned char* image_id = sqlite3_column_text(stmt, 0);
-			size_t               len      = (size_t) sqlite3_column_bytes(stmt, 0);
-			DBGLOG("SELECT SQL query returned: %s", image_id);
-
-			// Then we need the proper hashes Nickel devises...
-			// c.f., images_path @
-			// https://github.com/kovidgoyal/calibre/blob/205754891e341e7f940e70057ac3a96a2443fdbd/src/calibre/devices/kobo/driver.py#L2584-L2600
-			unsigned int hash = qhash(image_id, len);
-			unsigned int dir1 = hash & (0xff * 1);
-			unsigned int dir2 = (hash & (0xff00 * 1)) >> 8;
-
-			char images_path[KFMON_PATH_MAX];
-			int  ret = snprintf(images_path,
-                                           sizeof(images_path),
-                                           "%s/.kobo-images/%u/%u",
-                                           KFMON_TARGET_MOUNTPOINT,
-                                           dir1,
-                                           dir2);
-			if (ret < 0 || (size_t) ret >= sizeof(images_path)) {
-				LOG(LOG_WARNING, "Couldn't build the image path string!");
-			}
-			DBGLOG("Checking for thumbnails in '%s' . . .", images_path);
-
-			// Count the number of processed thumbnails we find...
-			uint8_t thumbnails_count = 0U;
-			char    thumbnail_path[KFMON_PATH_MAX];
-
-			// Start with the full-size screensaver...
-			ret = snprintf(
-			    thumbnail_path, sizeof(thumbnail_path), "%s/%s - N3_FULL.parsed", images_path, image_id);
-			if (ret < 0 || (size_t) ret >= sizeof(thumbnail_path)) {
-				LOG(LOG_WARNING, "Couldn't build the thumbnail path string!");
-			}
-			DBGLOG("Checking for full-size screensaver '%s' . . .", thumbnail_path);
-			if (access(thumbnail_path, F_OK) == 0) {
-				thumbnails_count++;
-			} else {
-				LOG(LOG_INFO, "Full-size screensaver hasn't been parsed yet!");
-			}
-
-			// Then the Homescreen tile...
-			// NOTE: This one might be a tad confusing...
-			//       If the icon has never been processed,
-			//       this will only happen the first time we *close* the PNG's "book"...
-			//       (i.e., the moment it pops up as the 'last opened' tile).
-			//       And *that* processing triggers a set of OPEN & CLOSE,
-			//       meaning we can quite possibly run on book *exit* that first time,
-			//       (and only that first time), if database locking permits...
-			ret = snprintf(thumbnail_path,
-				       sizeof(thumbnail_path),
-				       "%s/%s - N3_LIBRARY_FULL.parsed",
-				       images_path,
-				       image_id);
-			if (ret < 0 || (size_t) ret >= sizeof(thumbnail_path)) {
-				LOG(LOG_WARNING, "Couldn't build the thumbnail path string!");
-			}
-			DBGLOG("Checking for homescreen tile '%s' . . .", thumbnail_path);
-			if (access(thumbnail_path, F_OK) == 0) {
-				thumbnails_count++;
-			} else {
-				LOG(LOG_INFO, "Homescreen tile hasn't been parsed yet!");
+	// And finally the Library thumbnail...
+	ret = snprintf(thumbnail_path, sizeof(thumbnail_path), "%s/%s - N3_LIBRARY_GRID.parsed", images_path, image_id);
+	if (ret < 0 || (size_t) ret >= sizeof(thumbnail_path)) {
+		LOG(LOG_WARNING, "Couldn't build the thumbnail path string!");
+	}
+	DBGLOG("Checking for library thumbnail '%s' . . .", thumbnail_path);
+	if (access(thumbnail_path, F_OK) == 0) {
+		thumbnails_count++;
+	} else {
+		LOG(LOG_INFO, "Library thumbnail hasn't been parsed yet!");
+	}
+
+	// Only give a greenlight if we got all three!
+	return (thumbnails_count == 3U);
+}
+
+// Wait for Nickel's rollback journal to go away, if there's one (runs in the DB worker thread)
+// NOTE: We block on inotify for the journal's deletion, with a timerfd as our deadline,
+//       so we can go on the very instant the pending COMMIT is done.
+static void
+    wait_for_db_journal(void)
+{
+	// Fast path: that's the most likely outcome on FW >= 4.6.x
+	if (access(KOBO_DB_DIR "/" KOBO_DB_JOURNAL_NAME, F_OK) != 0) {
+		return;
+	}
+
+	int ifd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (ifd == -1) {
+		PFLOG(LOG_WARNING, "inotify_init1: %m");
+		return;
+	}
+	int tfd = -1;
+	// NOTE: The journal is deleted (or renamed) from its parent directory, so that's what we have to watch.
+	if (inotify_add_watch(ifd, KOBO_DB_DIR, IN_DELETE | IN_MOVED_FROM | IN_ONLYDIR) == -1) {
+		PFLOG(LOG_WARNING, "inotify_add_watch: %m");
+		goto cleanup;
+	}
+	// Now that the watch is up, make sure it didn't go away in the meantime...
+	if (access(KOBO_DB_DIR "/" KOBO_DB_JOURNAL_NAME, F_OK) != 0) {
+		goto cleanup;
+	}
+
+	tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (tfd == -1) {
+		PFLOG(LOG_WARNING, "timerfd_create: %m");
+		goto cleanup;
+	}
+	const struct itimerspec deadline = { .it_value = { KFMON_DB_JOURNAL_TIMEOUT, 0L } };
+	if (timerfd_settime(tfd, 0, &deadline, NULL) == -1) {
+		PFLOG(LOG_WARNING, "timerfd_settime: %m");
+		goto cleanup;
+	}
+
+	LOG(LOG_INFO, "Found a SQLite rollback journal, waiting for it to go away . . .");
+	struct timespec then = { 0 };
+	clock_gettime(CLOCK_MONOTONIC, &then);
+
+	struct pollfd pfds[2] = { { .fd = ifd, .events = POLLIN }, { .fd = tfd, .events = POLLIN } };
+	bool          is_gone = false;
+	while (!is_gone) {
+		int poll_num = poll(pfds, 2, -1);
+		if (poll_num == -1) {
+			if (errno == EINTR) {
+				continue;
 			}
+			PFLOG(LOG_WARNING, "poll: %m");
+			break;
+		}
+
+		if (pfds[1].revents & POLLIN) {
+			LOG(LOG_WARNING, "Waited for the SQLite rollback journal to go away for far too long, going on anyway.");
+			break;
+		}
 
-			// And finally the Library thumbnail...
-			ret = snprintf(thumbnail_path,
-				       sizeof(thumbnail_path),
-				       "%s/%s - N3_LIBRARY_GRID.parsed",
-				       images_path,
-				       image_id);
-			if (ret < 0 || (size_t) ret >= sizeof(thumbnail_path)) {
-				LOG(LOG_WARNING, "Couldn't build the thumbnail path string!");
+		if (pfds[0].revents & POLLIN) {
+			char                        buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+			const struct inotify_event* event;
+			ssize_t                     len;
+			while ((len = read(ifd, buf, sizeof(buf))) > 0) {    // Flawfinder: ignore
+				for (char* ptr = buf; ptr < buf + len; ptr += sizeof(*event) + event->len) {
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wcast-align"
+					event = (const struct inotify_event*) ptr;
+#pragma GCC diagnostic pop
+					if (event->len && strcmp(event->name, KOBO_DB_JOURNAL_NAME) == 0) {
+						is_gone = true;
+					}
+				}
 			}
-			DBGLOG("Checking for library thumbnail '%s' . . .", thumbnail_path);
-			if (access(thumbnail_path, F_OK) == 0) {
-				thumbnails_count++;
+		}
+	}
+
+	if (is_gone) {
+		struct timespec now = { 0 };
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		LOG(LOG_INFO,
+		    "SQLite rollback journal went away after %ld ms",
+		    (long) ((now.tv_sec - then.tv_sec) * 1000L + (now.tv_nsec - then.tv_nsec) / 1000000L));
+	}
+
+cleanup:
+	if (tfd != -1) {
+		close(tfd);
+	}
+	close(ifd);
+}
+
+// Check if our target file has been processed by Nickel... (runs in the DB worker thread)
+static bool
+    is_target_processed(DbJob* job)
+{
+#ifdef DEBUG
+	// Bypass DB checks on demand for debugging purposes...
+	if (job->skip_db_checks)
+		return true;
+#endif
+
+	// Did the user want to try to update the DB for this icon?
+	bool update       = job->do_db_update;
+	bool is_processed = false;
+	bool needs_update = false;
+
+	// NOTE: We reuse a long-lived read-only connection (and its prepared statements) for all the checks,
+	//       the read-write one is only ever used for the actual UPDATE.
+	sqlite3* db = get_kobo_db(false);
+	if (!db) {
+		return is_processed;
+	}
+	set_db_busy_timeout(db, job->wait_for_db);
+
+	// If nothing was committed to the DB since our last lookup for this watch, we already know the answer.
+	// NOTE: That's mainly useful for repeated taps on the same icon, and for the OPEN/CLOSE pair of a single tap.
+	// NOTE: A verdict that was carried over an export (c.f., leave_exported_state) predates our current connection,
+	//       so, it just has to be rebased on it.
+	DbVerdict* restrict cache        = &job->db_cache;
+	int64_t             data_version = get_db_data_version();
+	bool                from_cache   = cache->is_valid && data_version != -1 &&
+				((cache->db_generation == DBC.generation && cache->data_version == data_version) ||
+				 cache->is_carried_over);
+	if (from_cache) {
+		DBGLOG("DB is unchanged since our last check (data_version: %lld), reusing its results",
+		       (long long) data_version);
+		if (cache->is_carried_over) {
+			cache->data_version    = data_version;
+			cache->db_generation   = DBC.generation;
+			cache->is_carried_over = false;
+		}
+	} else {
+		// NOTE: A single lookup of the content row gives us everything we need:
+		//       whether it exists at all, its ImageID (for the thumbnails), and its Title (for do_db_update).
+		*cache = (const DbVerdict){ 0 };
+		// NOTE: Snapshot the DB *before* the lookup, so that anything committed in the meantime
+		//       can only make us err on the side of caution, c.f., leave_exported_state.
+		get_db_stamps(&cache->db_stamp, &cache->wal_stamp);
+
+		sqlite3_stmt* stmt = get_db_stmt(DB_STMT_CONTENT);
+		if (!stmt) {
+			return is_processed;
+		}
+
+		// Append the proper URI scheme to our icon path...
+		char book_path[CFG_SZ_MAX + 7];
+		snprintf(book_path, sizeof(book_path), "file://%s", job->filename);
+
+		int idx = sqlite3_bind_parameter_index(stmt, "@id");
+		CALL_SQLITE(bind_text(stmt, idx, book_path, -1, SQLITE_STATIC));
+
+		int rc = sqlite3_step(stmt);
+		if (rc == SQLITE_ROW) {
+			const unsigned char* image_id = sqlite3_column_text(stmt, 0);
+			const unsigned char* title    = sqlite3_column_text(stmt, 1);
+			DBGLOG("SELECT SQL query returned: %s | %s", image_id, title);
+
+			// NOTE: ImageID is basically a mangled version of the path, so, KFMON_PATH_MAX is plenty.
+			//       Make a copy, as we want to release the statement (and its read transaction) ASAP.
+			if (image_id && str5cpy(cache->image_id,
+						sizeof(cache->image_id),
+						(const char*) image_id,
+						sizeof(cache->image_id),
+						NOTRUNC) == 0) {
+				cache->exists = true;
 			} else {
-				LOG(LOG_INFO, "Library thumbnail hasn't been parsed yet!");
+				LOG(LOG_WARNING,
+				    "Couldn't make sense of the ImageID for '%s'!",
+				    job->filename);
 			}
 
-			// Only give a greenlight if we got all three!
-			if (thumbnails_count == 3U) {
+			// Check if the DB has already been updated by checking the title...
+			cache->title_matches = title && strcmp((const char*) title, job->db_title) == 0;
+		}
+
+		release_db_stmt(stmt);
+
+		// Only remember the results if the lookup actually went through
+		if (data_version != -1 && (rc == SQLITE_ROW || rc == SQLITE_DONE)) {
+			cache->data_version  = data_version;
+			cache->db_generation = DBC.generation;
+			cache->is_valid      = true;
+		}
+	}
+	is_processed = cache->exists;
+	needs_update = update && !cache->title_matches;
+
+	// NOTE: If the file doesn't appear to have been processed by Nickel yet, despite clearly existing on the FS,
+	//       since we got an inotify event from it, see if there isn't a case issue in the filename specified in the .ini...
+	//       (FAT32 is case-insensitive, but we make a case sensitive SQL query, because it's much faster!)
+	// NOTE: This works, but is commented out,
+	//       because it's a massive performance sink for what's essentially a very minor QOL fix for a PEBCAK...
+	/*
+	if (!is_processed) {
+		bool broken_case = false;
+
+		CALL_SQLITE(prepare_v2(
+		    db,
+		    "SELECT EXISTS(SELECT 1 FROM content WHERE ContentID = @id COLLATE NOCASE AND ContentType = '6');",
+		    -1,
+		    &stmt,
+		    NULL));
+		idx = sqlite3_bind_parameter_index(stmt, "@id");
+		CALL_SQLITE(bind_text(stmt, idx, book_path, -1, SQLITE_STATIC));
+
+		rc = sqlite3_step(stmt);
+		if (rc == SQLITE_ROW) {
+			DBGLOG("SELECT SQL query returned: %d", sqlite3_column_int(stmt, 0));
+			if (sqlite3_column_int(stmt, 0) == 1) {
 				is_processed = true;
+				broken_case  = true;
 			}
 		}
 
-		// NOTE: It's now safe to destroy the statement.
-		//       (We can't do that early in the success branch,
-		//       because we still hold a pointer to a result depending on the statement (image_id))
 		sqlite3_finalize(stmt);
+
+		// If the case-insensitive query worked, do yet another query to log the expected filename...
+		if (broken_case) {
+			CALL_SQLITE(prepare_v2(
+			    db,
+			    "SELECT ContentID FROM content WHERE ContentID = @id COLLATE NOCASE AND ContentType = '6';",
+			    -1,
+			    &stmt,
+			    NULL));
+			idx = sqlite3_bind_parameter_index(stmt, "@id");
+			CALL_SQLITE(bind_text(stmt, idx, book_path, -1, SQLITE_STATIC));
+
+			rc = sqlite3_step(stmt);
+			if (rc == SQLITE_ROW) {
+				// Warn, and update book_path, so we don't have to do any more slow case-insensitive queries...
+				snprintf(book_path, sizeof(book_path), "%s", sqlite3_column_text(stmt, 0));
+				DBGLOG("SELECT SQL query returned: %s", book_path);
+				LOG(LOG_WARNING,
+				    "Watch config @ index %hu has a filename field with broken case (%s -> %s)!",
+				    job->watch_idx,
+				    job->filename,
+				    book_path + 7);
+			}
+
+			sqlite3_finalize(stmt);
+		}
+	}
+	*/
+
+	// Now that we know the book exists, we also want to check if the thumbnails do,
+	// to avoid getting triggered from the thumbnail creation...
+	// NOTE: Again, this assumes FW >= 2.9.0
+	if (is_processed) {
+		// NOTE: Thumbnails don't go away once they've been generated,
+		//       so a positive verdict from an unchanged DB still stands.
+		if (!(from_cache && cache->is_processed)) {
+			if (job->thumbs_tracked && strcmp(job->thumbs_image_id, cache->image_id) == 0) {
+				// We're already keeping an eye on them via inotify, no need to go look for them.
+				is_processed = job->thumbs_ready;
+			} else {
+				// Assume they haven't been processed until we can confirm it...
+				is_processed = are_thumbnails_processed(cache->image_id);
+			}
+		}
+		cache->is_processed = is_processed;
 	}
 
 	// NOTE: Here be dragons!
@@ -1473,273 +2595,1576 @@ static bool
 	//       As such, we leave enabling this option to the user's responsibility.
 	//       KOReader ships with it disabled.
 	//       The idea is to, optionally, update the Title, Author & Comment fields to make them more useful...
-	if (is_processed && update) {
-		// Check if the DB has already been updated by checking the title...
-		CALL_SQLITE(prepare_v2(
-		    db, "SELECT Title FROM content WHERE ContentID = @id AND ContentType = '6';", -1, &stmt, NULL));
-
-		idx = sqlite3_bind_parameter_index(stmt, "@id");
-		CALL_SQLITE(bind_text(stmt, idx, book_path, -1, SQLITE_STATIC));
+	if (is_processed && needs_update) {
+		// Switch to our read-write connection
+		db = get_kobo_db(true);
+		if (!db) {
+			return is_processed;
+		}
+		set_db_busy_timeout(db, job->wait_for_db);
 
-		rc = sqlite3_step(stmt);
-		if (rc == SQLITE_ROW) {
-			DBGLOG("SELECT SQL query returned: %s", sqlite3_column_text(stmt, 0));
-			if (strcmp((const char*) sqlite3_column_text(stmt, 0), watchConfig[watch_idx].db_title) != 0) {
-				needs_update = true;
-			}
+		sqlite3_stmt* stmt = get_db_stmt(DB_STMT_UPDATE);
+		if (!stmt) {
+			return is_processed;
 		}
 
-		sqlite3_finalize(stmt);
-	}
-	if (needs_update) {
-		CALL_SQLITE(prepare_v2(
-		    db,
-		    "UPDATE content SET Title = @title, Attribution = @author, Description = @comment WHERE ContentID = @id AND ContentType = '6';",
-		    -1,
-		    &stmt,
-		    NULL));
+		// Append the proper URI scheme to our icon path...
+		char book_path[CFG_SZ_MAX + 7];
+		snprintf(book_path, sizeof(book_path), "file://%s", job->filename);
 
 		// NOTE: No sanity checks are done to confirm that those watch configs are sane,
 		//       we only check that they are *present*...
 		//       The example config ships with a strong warning not to forget them if wanted, but that's it.
-		idx = sqlite3_bind_parameter_index(stmt, "@title");
-		CALL_SQLITE(bind_text(stmt, idx, watchConfig[watch_idx].db_title, -1, SQLITE_STATIC));
+		int idx = sqlite3_bind_parameter_index(stmt, "@title");
+		CALL_SQLITE(bind_text(stmt, idx, job->db_title, -1, SQLITE_STATIC));
 		idx = sqlite3_bind_parameter_index(stmt, "@author");
-		CALL_SQLITE(bind_text(stmt, idx, watchConfig[watch_idx].db_author, -1, SQLITE_STATIC));
+		CALL_SQLITE(bind_text(stmt, idx, job->db_author, -1, SQLITE_STATIC));
 		idx = sqlite3_bind_parameter_index(stmt, "@comment");
-		CALL_SQLITE(bind_text(stmt, idx, watchConfig[watch_idx].db_comment, -1, SQLITE_STATIC));
+		CALL_SQLITE(bind_text(stmt, idx, job->db_comment, -1, SQLITE_STATIC));
 		idx = sqlite3_bind_parameter_index(stmt, "@id");
 		CALL_SQLITE(bind_text(stmt, idx, book_path, -1, SQLITE_STATIC));
 
-		rc = sqlite3_step(stmt);
+		int rc = sqlite3_step(stmt);
 		if (rc != SQLITE_DONE) {
 			LOG(LOG_WARNING, "UPDATE SQL query failed: %s", sqlite3_errmsg(db));
 		} else {
 			LOG(LOG_NOTICE, "Successfully updated DB data for the target PNG");
 		}
 
-		sqlite3_finalize(stmt);
+		release_db_stmt(stmt);
 	}
 
 	// A rather crappy check to wait for pending COMMITs...
-	if (is_processed && wait_for_db) {
+	if (is_processed && job->wait_for_db) {
 		// If there's a rollback journal for the DB, wait for it to go away...
 		// NOTE: This assumes the DB was opened with the default journal_mode, DELETE
 		//       This doesn't appear to be the case anymore, on FW >= 4.6.x (and possibly earlier),
 		//       it's now using WAL (which makes sense, and our whole job safer ;)).
-		const struct timespec zzz   = { 0L, 500000000L };
-		uint8_t               count = 0U;
-		while (access(KOBO_DB_PATH "-journal", F_OK) == 0) {
-			LOG(LOG_INFO,
-			    "Found a SQLite rollback journal, waiting for it to go away (iteration nr. %hhu) . . .",
-			    (uint8_t) count++);
-			nanosleep(&zzz, NULL);
-			// NOTE: Don't wait more than 10s
-			if (count >= 20U) {
-				LOG(LOG_WARNING,
-				    "Waited for the SQLite rollback journal to go away for far too long, going on anyway.");
-				break;
-			}
-		}
+		wait_for_db_journal();
 	}
 
-	sqlite3_close(db);
-
+	// NOTE: We keep our connections open, they'll be closed by the DB worker once they've been idle for a while.
 	return is_processed;
 }
 
-// Heavily inspired from https://stackoverflow.com/a/35235950
-// Initializes the process table. -1 means the entry in the table is available.
-static void
-    init_process_table(void)
+// Run the DB checks queued by the main thread, one at a time, in order (runs in a dedicated thread).
+// NOTE: This is the *only* thread that ever does SQL (or touches DBC),
+//       which is what allows us to keep SQLite single-threaded.
+static void*
+    db_worker_thread(void* ptr __attribute__((unused)))
 {
-	for (uint8_t i = 0U; i < WATCH_MAX; i++) {
-		PT.spawn_pids[i]     = -1;
-		PT.spawn_watchids[i] = -1;
-	}
-}
+	pthread_mutex_lock(&DBW.lock);
+	while (!DBW.quit) {
+		// The main thread wants us to start afresh (e.g., after an unmount)
+		if (DBW.reset_db) {
+			DBW.reset_db = false;
+			pthread_mutex_unlock(&DBW.lock);
+			close_kobo_db();
+			pthread_mutex_lock(&DBW.lock);
+			continue;
+		}
 
-// Returns the index of the next available entry in the process table.
-static int8_t
-    get_next_available_pt_entry(void)
-{
-	for (uint8_t i = 0U; i < WATCH_MAX; i++) {
-		if (PT.spawn_watchids[i] == -1) {
-			return (int8_t) i;
+		if (DBW.pending_count == 0U) {
+			if (DBC.ro_db || DBC.rw_db) {
+				// If we have a live DB connection, only keep it around for a little while,
+				// so we never get in the way of an unmount.
+				struct timespec deadline = { 0 };
+				clock_gettime(CLOCK_MONOTONIC, &deadline);
+				deadline.tv_sec += KFMON_DB_IDLE_TIMEOUT;
+				int rc = pthread_cond_timedwait(&DBW.cond, &DBW.lock, &deadline);
+				if (rc == ETIMEDOUT && DBW.pending_count == 0U) {
+					pthread_mutex_unlock(&DBW.lock);
+					DBGLOG("Releasing idle DB connections");
+					close_kobo_db();
+					pthread_mutex_lock(&DBW.lock);
+				}
+			} else {
+				pthread_cond_wait(&DBW.cond, &DBW.lock);
+			}
+			continue;
 		}
+
+		DbJob job        = DBW.pending[DBW.pending_head];
+		DBW.pending_head = (uint8_t) ((DBW.pending_head + 1U) % DB_JOB_MAX);
+		DBW.pending_count--;
+		pthread_mutex_unlock(&DBW.lock);
+
+		job.is_processed = is_target_processed(&job);
+
+		pthread_mutex_lock(&DBW.lock);
+		// NOTE: Can't overflow, as queue_db_check caps the amount of jobs in flight to DB_JOB_MAX.
+		DBW.done[(DBW.done_head + DBW.done_count) % DB_JOB_MAX] = job;
+		DBW.done_count++;
+		pthread_mutex_unlock(&DBW.lock);
+
+		// Wake the main thread up
+		uint64_t one = 1U;
+		if (write(DBW.efd, &one, sizeof(one)) == -1) {
+			PFLOG(LOG_WARNING, "write: %m");
+		}
+
+		pthread_mutex_lock(&DBW.lock);
 	}
-	return -1;
+	pthread_mutex_unlock(&DBW.lock);
+
+	close_kobo_db();
+	return (void*) NULL;
 }
 
-// Adds information about a new spawn to the process table.
+// Setup the eventfd & start the DB worker thread
 static void
-    add_process_to_table(uint8_t i, pid_t pid, uint8_t watch_idx)
+    start_db_worker(void)
 {
-	PT.spawn_pids[i]     = pid;
-	PT.spawn_watchids[i] = (int8_t) watch_idx;
+	// NOTE: Non-blocking, because it's handled by our event loop, and CLOEXEC not to pollute our spawns.
+	DBW.efd = eventfd(0U, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (DBW.efd == -1) {
+		PFLOG(LOG_ERR, "Aborting: eventfd: %m");
+		fbink_print(FBFD_AUTO, "[KFMon] eventfd failed ?!", &fbinkConfig);
+		exit(EXIT_FAILURE);
+	}
+	add_event_source(DBW.efd, EPOLLIN, handle_db_results, 0U);
+
+	// NOTE: We use a monotonic clock for the idle timeout, so that it's immune to wall clock jumps.
+	pthread_condattr_t cattr;
+	if (pthread_condattr_init(&cattr) != 0 || pthread_condattr_setclock(&cattr, CLOCK_MONOTONIC) != 0 ||
+	    pthread_cond_init(&DBW.cond, &cattr) != 0) {
+		LOG(LOG_ERR, "Failed to setup the DB worker's condition variable, aborting!");
+		fbink_print(FBFD_AUTO, "[KFMon] pthread_cond_init failed ?!", &fbinkConfig);
+		exit(EXIT_FAILURE);
+	}
+	pthread_condattr_destroy(&cattr);
+
+	if (pthread_create(&DBW.thread, NULL, db_worker_thread, NULL) != 0) {
+		PFLOG(LOG_ERR, "Aborting: pthread_create: %m");
+		fbink_print(FBFD_AUTO, "[KFMon] pthread_create failed ?!", &fbinkConfig);
+		exit(EXIT_FAILURE);
+	}
+	// NOTE: Not fatal, it's purely cosmetic.
+	if (pthread_setname_np(DBW.thread, "DB") != 0) {
+		PFLOG(LOG_WARNING, "pthread_setname_np: %m");
+	}
 }
 
-// Removes information about a spawn from the process table.
+// Ask the DB worker thread to wind down, and wait for it to do so
 static void
-    remove_process_from_table(uint8_t i)
+    stop_db_worker(void)
 {
-	PT.spawn_pids[i]     = -1;
-	PT.spawn_watchids[i] = -1;
+	pthread_mutex_lock(&DBW.lock);
+	DBW.quit = true;
+	pthread_cond_signal(&DBW.cond);
+	pthread_mutex_unlock(&DBW.lock);
+
+	pthread_join(DBW.thread, NULL);
+	remove_event_source(DBW.efd);
+	close(DBW.efd);
+	DBW.efd = -1;
 }
 
-// Initializes the FBInk config
+// Ask the DB worker thread to drop its DB connections before handling any further check
 static void
-    init_fbink_config(void)
+    reset_db_worker(void)
 {
-	// NOTE: The struct is zero-initialized, so we only tweak what's non-default
-	//       (the defaults are explicitly designed to always be 0 for this very purpose).
-	fbinkConfig.row         = -5;
-	fbinkConfig.is_centered = true;
-	fbinkConfig.is_padded   = true;
-	// NOTE: For now, we *want* fbink_init's status report logged, so we leave this disabled.
-	// fbinkConfig.is_quiet = false;
-	// If we log to syslog, tell FBInk to do the same
-	if (daemonConfig.use_syslog) {
-		fbinkConfig.to_syslog = true;
-	}
+	pthread_mutex_lock(&DBW.lock);
+	DBW.reset_db = true;
+	pthread_cond_signal(&DBW.cond);
+	pthread_mutex_unlock(&DBW.lock);
 }
 
-// Wait for a specific child process to die, and reap it (runs in a dedicated thread per spawn).
-static void*
-    reaper_thread(void* ptr)
+// Queue a DB check for a specific watch (wait_for_db is set on IN_CLOSE).
+// The verdict will be handled by handle_db_verdict, once the DB worker thread is done with it.
+static bool
+    queue_db_check(uint16_t watch_idx, bool wait_for_db)
 {
-	uint8_t i = *((uint8_t*) ptr);
+	// NOTE: There's no DB to speak of while we're exported, c.f., enter_exported_state.
+	if (daemonState == DAEMON_EXPORTED) {
+		LOG(LOG_INFO, "Not checking '%s' in the DB, as it's currently exported", watchConfig[watch_idx].filename);
+		return false;
+	}
 
-	pid_t tid = (pid_t) syscall(SYS_gettid);
+	pthread_mutex_lock(&DBW.lock);
+	if (DBW.in_flight >= DB_JOB_MAX) {
+		pthread_mutex_unlock(&DBW.lock);
+		LOG(LOG_WARNING,
+		    "Too many pending DB checks, dropping the one for '%s'!",
+		    watchConfig[watch_idx].filename);
+		return false;
+	}
 
-	pid_t   cpid;
-	uint8_t watch_idx;
-	pthread_mutex_lock(&ptlock);
-	cpid      = PT.spawn_pids[i];
-	watch_idx = (uint8_t) PT.spawn_watchids[i];
-	pthread_mutex_unlock(&ptlock);
+	DbJob* job          = &DBW.pending[(DBW.pending_head + DBW.pending_count) % DB_JOB_MAX];
+	*job                = (const DbJob){ 0 };
+	job->db_cache       = watchConfig[watch_idx].db_cache;
+	job->watch_idx      = watch_idx;
+	job->skip_db_checks = watchConfig[watch_idx].skip_db_checks;
+	job->do_db_update   = watchConfig[watch_idx].do_db_update;
+	job->wait_for_db    = wait_for_db;
+	str5cpy(job->filename, sizeof(job->filename), watchConfig[watch_idx].filename, CFG_SZ_MAX, TRUNC);
+	str5cpy(job->db_title, sizeof(job->db_title), watchConfig[watch_idx].db_title, DB_SZ_MAX, TRUNC);
+	str5cpy(job->db_author, sizeof(job->db_author), watchConfig[watch_idx].db_author, DB_SZ_MAX, TRUNC);
+	str5cpy(job->db_comment, sizeof(job->db_comment), watchConfig[watch_idx].db_comment, DB_SZ_MAX, TRUNC);
+	const ThumbsState* thumbs = &watchConfig[watch_idx].thumbs;
+	if (thumbs->wd != 0 || thumbs->is_ready) {
+		job->thumbs_tracked = true;
+		job->thumbs_ready   = thumbs->is_ready;
+		str5cpy(job->thumbs_image_id, sizeof(job->thumbs_image_id), thumbs->image_id, KFMON_PATH_MAX, TRUNC);
+	}
+	DBW.pending_count++;
+	DBW.in_flight++;
 
-	// Storage needed for get_current_time_r
-	struct tm local_tm;
-	char      sz_time[22];
+	pthread_cond_signal(&DBW.cond);
+	pthread_mutex_unlock(&DBW.lock);
 
-	// Remember the current time for the execvp errno/exitcode heuristic...
-	struct timespec then = { 0 };
-	clock_gettime(CLOCK_MONOTONIC_RAW, &then);
-
-	MTLOG(LOG_INFO,
-	      "[%s] [INFO] [TID: %ld] Waiting to reap process %ld (from watch idx %hhu) . . .",
-	      get_current_time_r(&local_tm, sz_time, sizeof(sz_time)),
-	      (long) tid,
-	      (long) cpid,
-	      watch_idx);
-	pid_t ret;
-	int   wstatus;
-	// Wait for our child process to terminate, retrying on EINTR
-	// NOTE: This is quite likely overkill on Linux (c.f., https://stackoverflow.com/a/59795677)
-	do {
-		ret = waitpid(cpid, &wstatus, 0);
-	} while (ret == -1 && errno == EINTR);
-	// Recap what happened to it
-	if (ret != cpid) {
-		PFMTLOG(LOG_CRIT, "waitpid: %m");
-		free(ptr);
-		return (void*) NULL;
-	} else {
-		if (WIFEXITED(wstatus)) {
-			int exitcode = WEXITSTATUS(wstatus);
-			MTLOG(
-			    LOG_NOTICE,
-			    "[%s] [NOTE] [TID: %ld] Reaped process %ld (from watch idx %hhu): It exited with status %d.",
-			    get_current_time_r(&local_tm, sz_time, sizeof(sz_time)),
-			    (long) tid,
-			    (long) cpid,
-			    watch_idx,
-			    exitcode);
-			// NOTE: Ugly hack to try to salvage execvp's potential error...
-			//       If the process exited with a non-zero status code,
-			//       within (roughly) a second of being launched,
-			//       assume the exit code is actually inherited from execvp's errno...
-			struct timespec now = { 0 };
-			clock_gettime(CLOCK_MONOTONIC_RAW, &now);
-			// NOTE: We should be okay not using difftime on Linux (We're using a monotonic clock, time_t is int64_t).
-			if (exitcode != 0 && (now.tv_sec - then.tv_sec) <= 1) {
-				char buf[256];
-				// NOTE: We *know* we'll be using the GNU, glibc >= 2.13 version of strerror_r
-				// NOTE: Even if it's not entirely clear from the manpage, printf's %m *is* thread-safe,
-				//       c.f., stdio-common/vfprintf.c:962 (it's using strerror_r).
-				//       But since we're not checking errno but a custom variable, do it the hard way :)
-				const char* sz_error = strerror_r(exitcode, buf, sizeof(buf));
-				MTLOG(
-				    LOG_CRIT,
-				    "[%s] [CRIT] [TID: %ld] If nothing was visibly launched, and/or especially if status > 1, this *may* actually be an execvp() error: %s.",
-				    get_current_time_r(&local_tm, sz_time, sizeof(sz_time)),
-				    (long) tid,
-				    sz_error);
-				fbink_printf(FBFD_AUTO,
-					     NULL,
-					     &fbinkConfig,
-					     "[KFMon] PID %ld exited unexpectedly: %d!",
-					     (long) cpid,
-					     exitcode);
-			}
-		} else if (WIFSIGNALED(wstatus)) {
-			// NOTE: strsignal is not thread safe... Use psignal instead.
-			int  sigcode = WTERMSIG(wstatus);
-			char buf[256];
-			snprintf(
-			    buf,
-			    sizeof(buf),
-			    "[KFMon] [%s] [WARN] [TID: %ld] Reaped process %ld (from watch idx %hhu): It was killed by signal %d",
-			    get_current_time_r(&local_tm, sz_time, sizeof(sz_time)),
-			    (long) tid,
-			    (long) cpid,
-			    watch_idx,
-			    sigcode);
-			fbink_printf(FBFD_AUTO,
-				     NULL,
-				     &fbinkConfig,
-				     "[KFMon] PID %ld was killed by signal %d!",
-				     (long) cpid,
-				     sigcode);
-			if (daemonConfig.use_syslog) {
-				// NOTE: No strsignal means no human-readable interpretation of the signal w/ syslog
-				//       (the %m token only works for errno)...
-				syslog(LOG_NOTICE, "%s", buf);
-			} else {
-				psignal(sigcode, buf);
-			}
-		}
+	return true;
+}
+
+// Pick up the verdicts of the DB checks the DB worker thread is done with
+static bool
+    handle_db_results(int fd, uint32_t events __attribute__((unused)), uint32_t data __attribute__((unused)))
+{
+	// Clear the eventfd
+	uint64_t count;
+	if (read(fd, &count, sizeof(count)) == -1 && errno != EAGAIN) {    // Flawfinder: ignore
+		PFLOG(LOG_WARNING, "read: %m");
 	}
 
-	// And now we can safely remove it from the process table
-	pthread_mutex_lock(&ptlock);
-	remove_process_from_table(i);
-	pthread_mutex_unlock(&ptlock);
+	// NOTE: We'll be printing stuff, so make sure we're up to date first...
+	fbink_reinit(FBFD_AUTO, &fbinkConfig);
+
+	// NOTE: Pop them one by one, as handling a verdict may spawn something, and we don't want to hold the lock then.
+	while (1) {
+		DbJob job;
+		pthread_mutex_lock(&DBW.lock);
+		if (DBW.done_count == 0U) {
+			pthread_mutex_unlock(&DBW.lock);
+			break;
+		}
+		job           = DBW.done[DBW.done_head];
+		DBW.done_head = (uint8_t) ((DBW.done_head + 1U) % DB_JOB_MAX);
+		DBW.done_count--;
+		DBW.in_flight--;
+		pthread_mutex_unlock(&DBW.lock);
 
-	free(ptr);
+		handle_db_verdict(&job);
+	}
 
-	return (void*) NULL;
+	// Now that there's room again, go on with resyncing our watches, if need be
+	queue_resync_checks();
+
+	return false;
 }
 
-// Spawn a process and return its pid...
-// Initially inspired from popen2() implementations from https://stackoverflow.com/questions/548063
-// As well as the glibc's system() call,
-// With a bit of added tracking to handle reaping without a SIGCHLD handler.
-static pid_t
-    spawn(char* const* command, uint8_t watch_idx)
+// Act on the verdict of a DB check, now that the DB worker thread is done with it
+static void
+    handle_db_verdict(const DbJob* job)
 {
-	pid_t pid = fork();
+	uint16_t watch_idx = job->watch_idx;
 
-	if (pid < 0) {
-		// Fork failed?
-		PFLOG(LOG_ERR, "Aborting: fork: %m");
-		fbink_print(FBFD_AUTO, "[KFMon] fork failed ?!", &fbinkConfig);
-		exit(EXIT_FAILURE);
-	} else if (pid == 0) {
+	// If we've been exported while that check was in flight, it's moot (c.f., enter_exported_state)
+	if (daemonState == DAEMON_EXPORTED) {
+		LOG(LOG_INFO, "Discarding the DB verdict for '%s', as we've been exported in the meantime.", job->filename);
+		return;
+	}
+	// Make sure the watch wasn't released or replaced while its check was in flight (c.f., update_watch_configs)
+	if (!watchConfig[watch_idx].is_active || strcmp(watchConfig[watch_idx].filename, job->filename) != 0) {
+		LOG(LOG_INFO,
+		    "Watch idx %hu changed while we were checking '%s' in the DB, discarding the verdict.",
+		    watch_idx,
+		    job->filename);
+		return;
+	}
+	// Remember what we learned, unless the DB metadata we're supposed to enforce changed in the meantime
+	if (strcmp(watchConfig[watch_idx].db_title, job->db_title) == 0) {
+		watchConfig[watch_idx].db_cache = job->db_cache;
+	}
+	// If the icon is in the DB but its thumbnails aren't there yet, keep an eye on them, if we were asked to
+	if (thumbs_fd != -1 && job->db_cache.exists && !job->is_processed && *job->db_cache.image_id &&
+	    strcmp(watchConfig[watch_idx].thumbs.image_id, job->db_cache.image_id) != 0) {
+		arm_thumbnail_watch(watch_idx, job->db_cache.image_id);
+	}
+
+	// IN_OPEN
+	if (!job->wait_for_db) {
+		if (!job->is_processed) {
+			// It's not processed on OPEN, flag as pending...
+			if (watchConfig[watch_idx].state != WATCH_PENDING) {
+				LOG(LOG_INFO, "Flagged target icon '%s' as pending processing ...", watchConfig[watch_idx].filename);
+			}
+			// NOTE: If it was already pending, that re-arms our next check.
+			set_watch_state(watch_idx, WATCH_PENDING);
+		} else if (watchConfig[watch_idx].state == WATCH_PENDING) {
+			// It was pending, and it's now processed: it's only *just* been, let it settle.
+			set_watch_state(watch_idx, WATCH_SETTLING);
+		}
+		return;
+	}
+
+	// IN_CLOSE
+	// NOTE: Something may have been spawned since the event was caught, so, check again...
+	bool is_watch_spawned   = is_watch_already_spawned(watch_idx);
+	bool is_blocker_spawned = is_blocker_running();
+	if (is_watch_spawned || is_blocker_spawned || are_spawns_blocked()) {
+		LOG(LOG_INFO,
+		    "Spawns for watch idx %hu (%s) got blocked while we were checking the DB, not spawning anything.",
+		    watch_idx,
+		    watchConfig[watch_idx].filename);
+		return;
+	}
+
+	// Check that our target file has already fully been processed by Nickel
+	// before launching anything...
+	if (!job->is_processed || watchConfig[watch_idx].state == WATCH_PENDING) {
+		LOG(LOG_NOTICE,
+		    "Target icon '%s' might not have been fully processed by Nickel yet, don't launch anything.",
+		    watchConfig[watch_idx].filename);
+		fbink_printf(FBFD_AUTO,
+			     NULL,
+			     &fbinkConfig,
+			     "[KFMon] Not spawning %s: still processing!",
+			     basename(watchConfig[watch_idx].action));
+		// NOTE: That, or we hit a SQLITE_BUSY timeout on OPEN,
+		//       which tripped our 'pending processing' check.
+		if (!job->is_processed) {
+			if (watchConfig[watch_idx].state != WATCH_PENDING) {
+				set_watch_state(watch_idx, WATCH_PENDING);
+			}
+		} else {
+			// Our OPEN check said otherwise, so it's only *just* been processed: let it settle,
+			// and count this one as the post-processing event, c.f., below.
+			set_watch_state(watch_idx, WATCH_SETTLING);
+			watchConfig[watch_idx].settle_closes = 1U;
+		}
+		return;
+	}
+
+	// NOTE: In case the target file has only just been processed,
+	//       wait for it to settle before trusting anything, to avoid spurious launches on start,
+	//       as FW 4.13 now appears to trigger an extra set of open/close events on startup,
+	//       right *after* having processed a new image. Which means that without this check,
+	//       it happily blazes right through every other checks,
+	//       and ends up running the new target script straightaway... :/
+	//       Since that's a single set, anything after that is assumed to be an actual tap,
+	//       and will launch as soon as the icon has settled, c.f., handle_watch_timer.
+	if (watchConfig[watch_idx].state == WATCH_SETTLING) {
+		if (watchConfig[watch_idx].settle_closes++ == 0U) {
+			LOG(LOG_NOTICE,
+			    "Target icon '%s' has only *just* finished processing, assuming this is a spurious post-processing event!",
+			    watchConfig[watch_idx].filename);
+			fbink_printf(FBFD_AUTO,
+				     NULL,
+				     &fbinkConfig,
+				     "[KFMon] Not spawning %s: still processing!",
+				     basename(watchConfig[watch_idx].action));
+		} else if (!watchConfig[watch_idx].deferred_spawn) {
+			LOG(LOG_NOTICE,
+			    "Target icon '%s' is still settling, %s will be launched once it has.",
+			    watchConfig[watch_idx].filename,
+			    watchConfig[watch_idx].action);
+			fbink_printf(FBFD_AUTO,
+				     NULL,
+				     &fbinkConfig,
+				     "[KFMon] Launching %s shortly . . .",
+				     basename(watchConfig[watch_idx].action));
+			watchConfig[watch_idx].deferred_spawn = true;
+		}
+		return;
+	}
+
+	if (!launch_watch(watch_idx)) {
+		queue_spawn(watch_idx, false);
+	}
+}
+
+// Move a watch to a new state, (re)arming or disarming its timer accordingly
+// NOTE: Entering PENDING or SETTLING (again) always (re)starts the clock.
+static void
+    set_watch_state(uint16_t watch_idx, WatchState state)
+{
+	static const char* const state_names[] = { "idle", "pending", "settling", "ready" };
+
+	if (watchConfig[watch_idx].state != state) {
+		LOG(LOG_INFO,
+		    "Watch idx %hu (%s) went from %s to %s",
+		    watch_idx,
+		    basename(watchConfig[watch_idx].filename),
+		    state_names[watchConfig[watch_idx].state],
+		    state_names[state]);
+
+		struct timespec now = { 0 };
+		clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+		watchConfig[watch_idx].state    = state;
+		watchConfig[watch_idx].state_ts = now.tv_sec;
+		if (state == WATCH_SETTLING) {
+			watchConfig[watch_idx].settle_closes = 0U;
+		}
+	}
+	// NOTE: A deferred spawn only survives as long as we're SETTLING.
+	if (state != WATCH_SETTLING) {
+		watchConfig[watch_idx].deferred_spawn = false;
+	}
+
+	time_t timeout = 0;
+	if (state == WATCH_PENDING) {
+		timeout = WATCH_PENDING_RECHECK;
+	} else if (state == WATCH_SETTLING) {
+		timeout = watchConfig[watch_idx].settle_delay;
+		if (timeout == 0) {
+			timeout = WATCH_SETTLE_DELAY;
+		}
+	}
+
+	if (timeout == 0) {
+		if (watchConfig[watch_idx].state_fd > 0) {
+			remove_event_source(watchConfig[watch_idx].state_fd);
+			close(watchConfig[watch_idx].state_fd);
+			watchConfig[watch_idx].state_fd = 0;
+		}
+		return;
+	}
+
+	if (watchConfig[watch_idx].state_fd <= 0) {
+		int timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+		if (timer_fd == -1) {
+			PFLOG(LOG_WARNING, "timerfd_create: %m");
+			// NOTE: Without a timer, we'd be stuck in there, so, skip ahead to the end.
+			set_watch_state(watch_idx, state == WATCH_SETTLING ? WATCH_READY : WATCH_IDLE);
+			return;
+		}
+		watchConfig[watch_idx].state_fd = timer_fd;
+		add_event_source(timer_fd, EPOLLIN, handle_watch_timer, watch_idx);
+	}
+	const struct itimerspec deadline = { .it_value = { .tv_sec = timeout } };
+	if (timerfd_settime(watchConfig[watch_idx].state_fd, 0, &deadline, NULL) == -1) {
+		PFLOG(LOG_WARNING, "timerfd_settime: %m");
+	}
+}
+
+// Handle a watch's PENDING or SETTLING timeout
+static bool
+    handle_watch_timer(int fd, uint32_t events __attribute__((unused)), uint32_t data)
+{
+	uint16_t watch_idx = (uint16_t) data;
+
+	// Clear the timerfd
+	uint64_t count;
+	if (read(fd, &count, sizeof(count)) == -1 && errno != EAGAIN) {    // Flawfinder: ignore
+		PFLOG(LOG_WARNING, "read: %m");
+	}
+
+	// NOTE: We might be printing stuff, so make sure we're up to date first...
+	fbink_reinit(FBFD_AUTO, &fbinkConfig);
+
+	if (watchConfig[watch_idx].state == WATCH_PENDING) {
+		struct timespec now = { 0 };
+		clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+		time_t timeout = watchConfig[watch_idx].pending_timeout;
+		if (timeout == 0) {
+			timeout = WATCH_PENDING_TIMEOUT;
+		}
+		if (now.tv_sec - watchConfig[watch_idx].state_ts >= timeout) {
+			LOG(LOG_NOTICE,
+			    "Target icon '%s' still hasn't been processed by Nickel, giving up on it for now.",
+			    watchConfig[watch_idx].filename);
+			set_watch_state(watch_idx, WATCH_IDLE);
+			return false;
+		}
+
+		// Ask the DB worker whether Nickel is done with it, c.f., handle_db_verdict.
+		if (!queue_db_check(watch_idx, false)) {
+			// Try again later...
+			set_watch_state(watch_idx, WATCH_PENDING);
+		}
+	} else if (watchConfig[watch_idx].state == WATCH_SETTLING) {
+		LOG(LOG_NOTICE, "Target icon '%s' should be properly processed by now :)", watchConfig[watch_idx].filename);
+		bool deferred_spawn = watchConfig[watch_idx].deferred_spawn;
+		set_watch_state(watch_idx, WATCH_READY);
+
+		if (deferred_spawn) {
+			// NOTE: Things may have changed since the tap, so, check again...
+			if (is_watch_already_spawned(watch_idx) || is_blocker_running() || are_spawns_blocked()) {
+				LOG(LOG_INFO,
+				    "Spawns for watch idx %hu (%s) got blocked while it was settling, not spawning anything.",
+				    watch_idx,
+				    watchConfig[watch_idx].filename);
+			} else if (!launch_watch(watch_idx)) {
+				queue_spawn(watch_idx, false);
+			}
+		}
+	}
+
+	return false;
+}
+
+// Spawn a watch's action, returns false if we couldn't (i.e., our process table is full)
+// NOTE: The caller is in charge of all the spawn blocking checks.
+static bool
+    launch_watch(uint16_t watch_idx)
+{
+	LOG(LOG_INFO, "Preparing to spawn %s for watch idx %hu . . .", watchConfig[watch_idx].action, watch_idx);
+	if (watchConfig[watch_idx].block_spawns) {
+		LOG(LOG_NOTICE,
+		    "%s is flagged as a spawn blocker, it will prevent *any* event from triggering a spawn while it is still running!",
+		    watchConfig[watch_idx].action);
+	}
+	// We're using execvp()...
+	char* const cmd[] = { watchConfig[watch_idx].action, NULL };
+	return spawn(cmd, watch_idx);
+}
+
+// (Re)create our thumbnails inotify instance, forgetting about everything we were tracking
+// NOTE: Called at the top of the main loop, i.e., before watch slots may get shuffled around by update_watch_configs.
+static void
+    reset_thumbnail_watches(void)
+{
+	if (thumbs_fd != -1) {
+		remove_event_source(thumbs_fd);
+		close(thumbs_fd);
+		thumbs_fd = -1;
+	}
+	for (uint16_t watch_idx = 0U; watch_idx < watchListSize; watch_idx++) {
+		if (watchConfig[watch_idx].thumbs.wd != 0) {
+			unlink_thumbnail_watch(watch_idx);
+		}
+		watchConfig[watch_idx].thumbs = (const ThumbsState){ 0 };
+	}
+
+	thumbs_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (thumbs_fd == -1) {
+		// NOTE: Not fatal, we'll just go back to looking for them on each check.
+		PFLOG(LOG_WARNING, "inotify_init1: %m");
+	} else {
+		add_event_source(thumbs_fd, EPOLLIN, handle_thumbnail_events, 0U);
+	}
+}
+
+// Index a watch by the wd of the thumbnails directory it's now waiting on (it mustn't be waiting on anything yet)
+// NOTE: Watches on the same directory share the same wd, so, only the first one is indexed,
+//       and the others are chained to it (c.f., ThumbsState).
+static void
+    link_thumbnail_watch(uint16_t watch_idx, int wd)
+{
+	ThumbsState* restrict thumbs = &watchConfig[watch_idx].thumbs;
+	int32_t               first  = find_watch_key(WATCH_KEY_THUMBS_WD, wd, NULL);
+
+	thumbs->wd   = wd;
+	thumbs->prev = first;
+	thumbs->next = -1;
+	if (first == -1) {
+		insert_watch_key(WATCH_KEY_THUMBS_WD, watch_idx);
+		return;
+	}
+
+	// Chain it right after the first one
+	ThumbsState* restrict head = &watchConfig[first].thumbs;
+	thumbs->next               = head->next;
+	if (head->next != -1) {
+		watchConfig[head->next].thumbs.prev = (int32_t) watch_idx;
+	}
+	head->next = (int32_t) watch_idx;
+}
+
+// Drop a watch from the thumbnails index, returns true if it was the last one waiting on that directory
+static bool
+    unlink_thumbnail_watch(uint16_t watch_idx)
+{
+	ThumbsState* restrict thumbs  = &watchConfig[watch_idx].thumbs;
+	bool                  is_last = thumbs->prev == -1 && thumbs->next == -1;
+
+	if (thumbs->prev == -1) {
+		// It was the indexed one, so, the next one (if any) takes its place.
+		erase_watch_key(WATCH_KEY_THUMBS_WD, watch_idx);
+		if (thumbs->next != -1) {
+			watchConfig[thumbs->next].thumbs.prev = -1;
+			insert_watch_key(WATCH_KEY_THUMBS_WD, (uint16_t) thumbs->next);
+		}
+	} else {
+		watchConfig[thumbs->prev].thumbs.next = thumbs->next;
+		if (thumbs->next != -1) {
+			watchConfig[thumbs->next].thumbs.prev = thumbs->prev;
+		}
+	}
+
+	thumbs->wd   = 0;
+	thumbs->prev = -1;
+	thumbs->next = -1;
+	return is_last;
+}
+
+// Stop watching for a specific watch's thumbnails (what we already know about them is kept)
+static void
+    drop_thumbnail_watch(uint16_t watch_idx)
+{
+	ThumbsState* restrict thumbs = &watchConfig[watch_idx].thumbs;
+
+	if (thumbs->wd != 0) {
+		// NOTE: Watches on the same directory share the same wd, so only remove it if we're its last user.
+		int wd = thumbs->wd;
+		if (unlink_thumbnail_watch(watch_idx) && inotify_rm_watch(thumbs_fd, wd) == -1) {
+			PFLOG(LOG_WARNING, "inotify_rm_watch: %m");
+		}
+	}
+
+	thumbs->wd    = 0;
+	thumbs->depth = 0U;
+}
+
+// Start watching the directory where Nickel will store the thumbnails of a specific watch's icon
+static void
+    arm_thumbnail_watch(uint16_t watch_idx, const char* image_id)
+{
+	ThumbsState* restrict thumbs = &watchConfig[watch_idx].thumbs;
+
+	// NOTE: image_id may very well point to thumbs->image_id itself, so, make a copy first.
+	char id[KFMON_PATH_MAX];
+	str5cpy(id, sizeof(id), image_id, KFMON_PATH_MAX, TRUNC);
+	drop_thumbnail_watch(watch_idx);
+	// NOTE: We may be in the middle of handling an event for it, c.f., handle_thumbnail_events.
+	*thumbs = (const ThumbsState){ .event_seq = thumbs->event_seq };
+	str5cpy(thumbs->image_id, sizeof(thumbs->image_id), id, KFMON_PATH_MAX, TRUNC);
+
+	// Walk up the shard hierarchy until we find a directory that actually exists
+	char path[KFMON_PATH_MAX];
+	get_images_path(id, path, sizeof(path));
+	for (int8_t depth = THUMBS_SHARD_DEPTH; depth >= 0; depth--) {
+		int wd = inotify_add_watch(thumbs_fd, path, THUMBS_WATCH_MASK);
+		if (wd != -1) {
+			link_thumbnail_watch(watch_idx, wd);
+			thumbs->depth = (uint8_t) depth;
+			break;
+		}
+		if (errno != ENOENT) {
+			PFLOG(LOG_WARNING, "inotify_add_watch: %m");
+			return;
+		}
+
+		char* sep = strrchr(path, '/');
+		if (sep) {
+			*sep = '\0';
+		}
+	}
+	if (thumbs->wd == 0) {
+		LOG(LOG_WARNING, "Couldn't find anywhere to watch for the thumbnails of '%s'!", watchConfig[watch_idx].filename);
+		return;
+	}
+	LOG(LOG_INFO, "Watching '%s' for the thumbnails of '%s'", path, watchConfig[watch_idx].filename);
+
+	// NOTE: Now that the watch is up, check what's already there, to make sure we can't miss anything.
+	//       That's the only time we ever go look for them, the rest is event-driven.
+	if (thumbs->depth == THUMBS_SHARD_DEPTH) {
+		for (uint8_t i = 0U; i < sizeof(thumbnail_kinds) / sizeof(*thumbnail_kinds); i++) {
+			char thumbnail_path[KFMON_PATH_MAX * 2U];
+			snprintf(thumbnail_path, sizeof(thumbnail_path), "%s/%s - %s.parsed", path, id, thumbnail_kinds[i]);
+			if (access(thumbnail_path, F_OK) == 0) {
+				thumbs->seen |= (uint8_t) (1U << i);
+			}
+		}
+		if (thumbs->seen == THUMBS_ALL_SEEN) {
+			LOG(LOG_INFO, "Thumbnails for '%s' are already there", watchConfig[watch_idx].filename);
+			thumbs->is_ready = true;
+			drop_thumbnail_watch(watch_idx);
+		}
+	}
+}
+
+// Handle the inotify events on the thumbnails' directories
+static bool
+    handle_thumbnail_events(int fd, uint32_t events __attribute__((unused)), uint32_t data __attribute__((unused)))
+{
+	char                        buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	const struct inotify_event* event;
+
+	for (;;) {
+		ssize_t len = read(fd, buf, sizeof(buf));    // Flawfinder: ignore
+		if (len == -1 && errno != EAGAIN) {
+			if (errno == EINTR) {
+				continue;
+			}
+			PFLOG(LOG_WARNING, "read: %m");
+			break;
+		}
+		if (len <= 0) {
+			break;
+		}
+
+		for (char* ptr = buf; ptr < buf + len; ptr += sizeof(*event) + event->len) {
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wcast-align"
+			event = (const struct inotify_event*) ptr;
+#pragma GCC diagnostic pop
+
+			// NOTE: Several watches may share the same directory, so, walk the whole chain.
+			//       Handling an event may move a watch elsewhere (possibly further down this very chain),
+			//       so, remember what's next beforehand, and make sure we never handle the same event twice.
+			thumbs_event_seq++;
+			int32_t next = find_watch_key(WATCH_KEY_THUMBS_WD, event->wd, NULL);
+			while (next != -1) {
+				uint16_t              watch_idx = (uint16_t) next;
+				ThumbsState* restrict thumbs    = &watchConfig[watch_idx].thumbs;
+				next                            = thumbs->next;
+				if (thumbs->event_seq == thumbs_event_seq) {
+					continue;
+				}
+				thumbs->event_seq = thumbs_event_seq;
+
+				// The directory is gone (or was unmounted), we'll go back to probing on the next check.
+				if (event->mask & IN_IGNORED) {
+					unlink_thumbnail_watch(watch_idx);
+					*thumbs = (const ThumbsState){ 0 };
+					continue;
+				}
+				if (!event->len) {
+					continue;
+				}
+
+				if (thumbs->depth < THUMBS_SHARD_DEPTH) {
+					// The next level of the shard hierarchy might have just been created, move down.
+					if (event->mask & IN_ISDIR) {
+						arm_thumbnail_watch(watch_idx, thumbs->image_id);
+					}
+					continue;
+				}
+				// Only consider files once they've been fully written
+				if (!(event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))) {
+					continue;
+				}
+
+				for (uint8_t i = 0U; i < sizeof(thumbnail_kinds) / sizeof(*thumbnail_kinds); i++) {
+					char name[KFMON_PATH_MAX * 2U];
+					snprintf(name, sizeof(name), "%s - %s.parsed", thumbs->image_id, thumbnail_kinds[i]);
+					if (strcmp(event->name, name) == 0) {
+						LOG(LOG_INFO,
+						    "Nickel generated the %s thumbnail for '%s'",
+						    thumbnail_kinds[i],
+						    watchConfig[watch_idx].filename);
+						thumbs->seen |= (uint8_t) (1U << i);
+						break;
+					}
+				}
+				if (thumbs->seen == THUMBS_ALL_SEEN) {
+					LOG(LOG_NOTICE,
+					    "Target icon '%s' has just been fully processed by Nickel",
+					    watchConfig[watch_idx].filename);
+					thumbs->is_ready = true;
+					// NOTE: Let it settle from the actual end of the processing,
+					//       c.f., the spurious post-processing event check in handle_db_verdict.
+					if (watchConfig[watch_idx].state != WATCH_SETTLING) {
+						set_watch_state(watch_idx, WATCH_SETTLING);
+					}
+					drop_thumbnail_watch(watch_idx);
+				}
+			}
+		}
+	}
+
+	return false;
+}
+
+// Create our event loop's epoll instance
+static void
+    init_reactor(void)
+{
+	// NOTE: CLOEXEC not to pollute our spawns.
+	Reactor.epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (Reactor.epfd == -1) {
+		PFLOG(LOG_ERR, "Aborting: epoll_create1: %m");
+		fbink_print(FBFD_AUTO, "[KFMon] epoll_create1 failed ?!", &fbinkConfig);
+		exit(EXIT_FAILURE);
+	}
+}
+
+// Start watching fd for events, which will be dispatched to handler (along with data)
+// NOTE: Every fd we hand over to the event loop is non-blocking, as no handler may ever block it.
+static void
+    add_event_source(int fd, uint32_t events, EventHandler handler, uint32_t data)
+{
+	if (fd >= Reactor.size) {
+		int new_size = MAX(16, Reactor.size * 2);
+		if (new_size <= fd) {
+			new_size = fd + 1;
+		}
+		EventSource* new_sources = realloc(Reactor.sources, (size_t) new_size * sizeof(*new_sources));
+		if (new_sources == NULL) {
+			PFLOG(LOG_ERR, "Aborting: realloc: %m");
+			fbink_print(FBFD_AUTO, "[KFMon] OOM ?!", &fbinkConfig);
+			exit(EXIT_FAILURE);
+		}
+		memset(new_sources + Reactor.size, 0, (size_t) (new_size - Reactor.size) * sizeof(*new_sources));
+		Reactor.sources = new_sources;
+		Reactor.size    = new_size;
+	}
+
+	EventSource* source = &Reactor.sources[fd];
+	source->handler     = handler;
+	source->data        = data;
+	source->gen++;
+
+	// NOTE: We pack the fd & its generation in the event's data, c.f., run_reactor.
+	struct epoll_event ev = { .events = events, .data.u64 = ((uint64_t) source->gen << 32U) | (uint32_t) fd };
+	if (epoll_ctl(Reactor.epfd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+		PFLOG(LOG_ERR, "Aborting: epoll_ctl: %m");
+		fbink_print(FBFD_AUTO, "[KFMon] epoll_ctl failed ?!", &fbinkConfig);
+		exit(EXIT_FAILURE);
+	}
+}
+
+// Change the events we're watching fd for (0 effectively pauses it)
+static void
+    mod_event_source(int fd, uint32_t events)
+{
+	struct epoll_event ev = { .events   = events,
+				  .data.u64 = ((uint64_t) Reactor.sources[fd].gen << 32U) | (uint32_t) fd };
+	if (epoll_ctl(Reactor.epfd, EPOLL_CTL_MOD, fd, &ev) == -1) {
+		PFLOG(LOG_WARNING, "epoll_ctl: %m");
+	}
+}
+
+// Stop watching fd for events. Must be called *before* closing it.
+static void
+    remove_event_source(int fd)
+{
+	if (fd < 0 || fd >= Reactor.size || Reactor.sources[fd].handler == NULL) {
+		return;
+	}
+
+	if (epoll_ctl(Reactor.epfd, EPOLL_CTL_DEL, fd, NULL) == -1) {
+		PFLOG(LOG_WARNING, "epoll_ctl: %m");
+	}
+	Reactor.sources[fd].handler = NULL;
+	Reactor.sources[fd].data    = 0U;
+}
+
+// Wait for events, and dispatch them to their handlers, until one of them asks us to stop
+static void
+    run_reactor(void)
+{
+	struct epoll_event events[32];
+
+	while (1) {
+		int n = epoll_wait(Reactor.epfd, events, (int) (sizeof(events) / sizeof(*events)), -1);
+		if (n == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			PFLOG(LOG_ERR, "Aborting: epoll_wait: %m");
+			fbink_print(FBFD_AUTO, "[KFMon] epoll_wait failed ?!", &fbinkConfig);
+			exit(EXIT_FAILURE);
+		}
+
+		bool stop = false;
+		for (int i = 0; i < n; i++) {
+			int      fd  = (int) (events[i].data.u64 & UINT32_MAX);
+			uint32_t gen = (uint32_t) (events[i].data.u64 >> 32U);
+			// NOTE: A previous handler in this batch may have removed this fd (or even recycled it since),
+			//       in which case the event is stale, and we just skip it.
+			if (fd >= Reactor.size || Reactor.sources[fd].handler == NULL || Reactor.sources[fd].gen != gen) {
+				continue;
+			}
+			if (Reactor.sources[fd].handler(fd, events[i].events, Reactor.sources[fd].data)) {
+				stop = true;
+			}
+		}
+		// NOTE: We still dispatch the rest of the batch first, so as not to lose anything.
+		if (stop) {
+			return;
+		}
+
+		// Now that the dust has settled, see if any of our queued launch requests can go through
+		dispatch_spawn_queue();
+	}
+}
+
+// Heavily inspired from https://stackoverflow.com/a/35235950
+// Initializes the process table. -1 means the entry in the table is available.
+static void
+    init_process_table(void)
+{
+	if (!grow_process_table()) {
+		LOG(LOG_ERR, "Couldn't allocate memory for the process table, aborting!");
+		exit(EXIT_FAILURE);
+	}
+}
+
+// Double the size of the process table.
+static bool
+    grow_process_table(void)
+{
+	if (PT.size >= WATCH_MAX) {
+		return false;
+	}
+	uint16_t new_size = (uint16_t) MIN((uint32_t) WATCH_MAX, MAX(WATCH_MIN, PT.size * 2U));
+	pid_t*   pids     = realloc(PT.spawn_pids, new_size * sizeof(*pids));
+	if (pids == NULL) {
+		PFLOG(LOG_ERR, "realloc: %m");
+		return false;
+	}
+	PT.spawn_pids     = pids;
+	int32_t* watchids = realloc(PT.spawn_watchids, new_size * sizeof(*watchids));
+	if (watchids == NULL) {
+		PFLOG(LOG_ERR, "realloc: %m");
+		return false;
+	}
+	PT.spawn_watchids = watchids;
+	int* pidfds       = realloc(PT.spawn_pidfds, new_size * sizeof(*pidfds));
+	if (pidfds == NULL) {
+		PFLOG(LOG_ERR, "realloc: %m");
+		return false;
+	}
+	PT.spawn_pidfds        = pidfds;
+	struct timespec* times = realloc(PT.spawn_times, new_size * sizeof(*times));
+	if (times == NULL) {
+		PFLOG(LOG_ERR, "realloc: %m");
+		return false;
+	}
+	PT.spawn_times  = times;
+	char* filenames = realloc(PT.spawn_filenames, new_size * CFG_SZ_MAX);
+	if (filenames == NULL) {
+		PFLOG(LOG_ERR, "realloc: %m");
+		return false;
+	}
+	PT.spawn_filenames = filenames;
+	bool* blocks       = realloc(PT.spawn_blocks, new_size * sizeof(*blocks));
+	if (blocks == NULL) {
+		PFLOG(LOG_ERR, "realloc: %m");
+		return false;
+	}
+	PT.spawn_blocks = blocks;
+	bool* zygotes   = realloc(PT.spawn_via_zygote, new_size * sizeof(*zygotes));
+	if (zygotes == NULL) {
+		PFLOG(LOG_ERR, "realloc: %m");
+		return false;
+	}
+	PT.spawn_via_zygote = zygotes;
+	uint16_t  old_words = (uint16_t) ((PT.size + 31U) / 32U);
+	uint16_t  new_words = (uint16_t) ((new_size + 31U) / 32U);
+	uint32_t* free_map  = realloc(PT.free_map, new_words * sizeof(*free_map));
+	if (free_map == NULL) {
+		PFLOG(LOG_ERR, "realloc: %m");
+		return false;
+	}
+	memset(free_map + old_words, 0, (size_t) (new_words - old_words) * sizeof(*free_map));
+	PT.free_map = free_map;
+
+	for (uint16_t i = PT.size; i < new_size; i++) {
+		PT.spawn_pids[i]                   = -1;
+		PT.spawn_watchids[i]               = -1;
+		PT.spawn_pidfds[i]                 = -1;
+		PT.spawn_times[i]                  = (struct timespec){ 0 };
+		PT.spawn_blocks[i]                 = false;
+		PT.spawn_via_zygote[i]             = false;
+		PT.spawn_filenames[i * CFG_SZ_MAX] = '\0';
+		PT.free_map[i / 32U] |= 1U << (i % 32U);
+	}
+	PT.size = new_size;
+	return true;
+}
+
+// Keep our watch -> process table entry map as large as the watch list (c.f., grow_watch_list)
+static bool
+    grow_pt_watch_slots(uint16_t new_size)
+{
+	int32_t* slots = realloc(PT.watch_slots, new_size * sizeof(*slots));
+	if (slots == NULL) {
+		PFLOG(LOG_ERR, "realloc: %m");
+		return false;
+	}
+	memset(slots + PT.watch_slots_size, -1, (size_t) (new_size - PT.watch_slots_size) * sizeof(*slots));
+	PT.watch_slots      = slots;
+	PT.watch_slots_size = new_size;
+	return true;
+}
+
+// Returns the index of the next available entry in the process table (growing it if need be).
+// NOTE: That's the lowest set bit in our free map, which we can find a word at a time.
+static int32_t
+    get_next_available_pt_entry(void)
+{
+	uint16_t words = (uint16_t) ((PT.size + 31U) / 32U);
+	for (uint16_t w = 0U; w < words; w++) {
+		if (PT.free_map[w] != 0U) {
+			return (int32_t) (w * 32U + (uint32_t) __builtin_ctz(PT.free_map[w]));
+		}
+	}
+
+	uint16_t i = PT.size;
+	if (!grow_process_table()) {
+		return -1;
+	}
+	return (int32_t) i;
+}
+
+// Adds information about a new spawn to the process table.
+// NOTE: If it was launched by our zygote, it's not our child, so we leave the reaping to it, c.f., handle_zygote_reply.
+static void
+    add_process_to_table(uint16_t i, pid_t pid, uint16_t watch_idx, bool via_zygote)
+{
+	PT.spawn_pids[i]       = pid;
+	PT.spawn_watchids[i]   = (int32_t) watch_idx;
+	PT.spawn_via_zygote[i] = via_zygote;
+	PT.spawn_pidfds[i]     = (use_pidfd && !via_zygote) ? open_pidfd(pid) : -1;
+	if (PT.spawn_pidfds[i] != -1) {
+		add_event_source(PT.spawn_pidfds[i], EPOLLIN, handle_pidfd, i);
+	}
+	// Remember the current time for the execvp errno/exitcode heuristic (and our accounting)...
+	clock_gettime(CLOCK_MONOTONIC_RAW, &PT.spawn_times[i]);
+	str5cpy(&PT.spawn_filenames[i * CFG_SZ_MAX], CFG_SZ_MAX, watchConfig[watch_idx].filename, CFG_SZ_MAX, TRUNC);
+
+	PT.free_map[i / 32U] &= ~(1U << (i % 32U));
+	PT.watch_slots[watch_idx] = (int32_t) i;
+	update_spawn_blocker(watch_idx);
+}
+
+// Removes information about a spawn from the process table.
+static void
+    remove_process_from_table(uint16_t i)
+{
+	if (PT.spawn_pidfds[i] != -1) {
+		remove_event_source(PT.spawn_pidfds[i]);
+		close(PT.spawn_pidfds[i]);
+	}
+	if (PT.spawn_blocks[i]) {
+		PT.blockers--;
+	}
+	if (PT.spawn_watchids[i] != -1 && PT.watch_slots[PT.spawn_watchids[i]] == (int32_t) i) {
+		PT.watch_slots[PT.spawn_watchids[i]] = -1;
+	}
+	PT.spawn_pids[i]                   = -1;
+	PT.spawn_watchids[i]               = -1;
+	PT.spawn_pidfds[i]                 = -1;
+	PT.spawn_times[i]                  = (struct timespec){ 0 };
+	PT.spawn_blocks[i]                 = false;
+	PT.spawn_via_zygote[i]             = false;
+	PT.spawn_filenames[i * CFG_SZ_MAX] = '\0';
+	PT.free_map[i / 32U] |= 1U << (i % 32U);
+}
+
+// Make sure the running spawn of a watch (if any) is accounted for properly in our spawn blockers count.
+// NOTE: Has to be called whenever that watch's block_spawns or is_active flags might have changed,
+//       to match what its config says *now* (i.e., a reloaded config can lift the block of a running spawn).
+static void
+    update_spawn_blocker(uint16_t watch_idx)
+{
+	if (!is_watch_already_spawned(watch_idx)) {
+		return;
+	}
+
+	uint16_t i      = (uint16_t) PT.watch_slots[watch_idx];
+	bool     blocks = watchConfig[watch_idx].is_active && watchConfig[watch_idx].block_spawns;
+	if (blocks != PT.spawn_blocks[i]) {
+		PT.spawn_blocks[i] = blocks;
+		if (blocks) {
+			PT.blockers++;
+		} else {
+			PT.blockers--;
+		}
+	}
+}
+
+// Queue a launch request we can't honor right now.
+// Returns its (1-based) position in the queue, or -1 if the queue is full.
+static int32_t
+    queue_spawn(uint16_t watch_idx, bool force)
+{
+	// Make some room first, if we can
+	prune_spawn_queue();
+
+	// If it's already queued, keep its place in line
+	for (uint8_t i = 0U; i < SpawnQueue.count; i++) {
+		if (SpawnQueue.requests[i].watch_idx == watch_idx) {
+			SpawnQueue.requests[i].force |= force;
+			return i + 1;
+		}
+	}
+
+	if (SpawnQueue.count >= SPAWN_QUEUE_MAX) {
+		LOG(LOG_WARNING,
+		    "Our spawn queue is full, dropping the request for watch idx %hu (%s)",
+		    watch_idx,
+		    watchConfig[watch_idx].filename);
+		fbink_printf(FBFD_AUTO,
+			     NULL,
+			     &fbinkConfig,
+			     "[KFMon] Not spawning %s: too busy!",
+			     basename(watchConfig[watch_idx].action));
+		return -1;
+	}
+
+	struct timespec now = { 0 };
+	clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+	SpawnRequest* req = &SpawnQueue.requests[SpawnQueue.count++];
+	req->deadline     = now.tv_sec + SPAWN_QUEUE_TIMEOUT;
+	str5cpy(req->filename, sizeof(req->filename), watchConfig[watch_idx].filename, CFG_SZ_MAX, TRUNC);
+	req->watch_idx = watch_idx;
+	req->force     = force;
+
+	LOG(LOG_NOTICE,
+	    "Queued the launch of %s for watch idx %hu (#%hhu in line, for up to %us)",
+	    watchConfig[watch_idx].action,
+	    watch_idx,
+	    SpawnQueue.count,
+	    SPAWN_QUEUE_TIMEOUT);
+	fbink_printf(FBFD_AUTO,
+		     NULL,
+		     &fbinkConfig,
+		     "[KFMon] Launching %s later . . .",
+		     basename(watchConfig[watch_idx].action));
+	return SpawnQueue.count;
+}
+
+// Drop queued requests that expired, or whose watch is gone (or was replaced), keeping the rest in order
+static void
+    prune_spawn_queue(void)
+{
+	struct timespec now = { 0 };
+	clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+
+	uint8_t kept = 0U;
+	for (uint8_t i = 0U; i < SpawnQueue.count; i++) {
+		const SpawnRequest* req       = &SpawnQueue.requests[i];
+		uint16_t            watch_idx = req->watch_idx;
+		if (now.tv_sec >= req->deadline) {
+			LOG(LOG_NOTICE, "Queued launch request for '%s' expired, dropping it", req->filename);
+		} else if (watch_idx >= watchListSize || !watchConfig[watch_idx].is_active ||
+			   strcmp(watchConfig[watch_idx].filename, req->filename) != 0) {
+			LOG(LOG_NOTICE, "Watch for queued launch request '%s' is gone, dropping it", req->filename);
+		} else {
+			if (kept != i) {
+				SpawnQueue.requests[kept] = *req;
+			}
+			kept++;
+		}
+	}
+	SpawnQueue.count = kept;
+}
+
+// Launch whatever we can from our queue, in order
+// NOTE: Called by the event loop after each batch of events (c.f., run_reactor),
+//       i.e., once things have had a chance to change (a spawn died, a config was reloaded, ...),
+//       but never from the middle of a spawn (c.f., zygote_spawn).
+static void
+    dispatch_spawn_queue(void)
+{
+	if (SpawnQueue.count == 0U || daemonState != DAEMON_RUNNING) {
+		return;
+	}
+
+	prune_spawn_queue();
+	while (SpawnQueue.count > 0U) {
+		const SpawnRequest* req       = &SpawnQueue.requests[0];
+		uint16_t            watch_idx = req->watch_idx;
+		if (!req->force && (is_blocker_running() || are_spawns_blocked())) {
+			// Still blocked, keep waiting
+			break;
+		}
+
+		if (is_watch_already_spawned(watch_idx)) {
+			LOG(LOG_INFO,
+			    "Watch idx %hu (%s) is already running, dropping its queued launch request",
+			    watch_idx,
+			    watchConfig[watch_idx].filename);
+		} else {
+			LOG(LOG_INFO, "Dispatching queued launch request for watch idx %hu", watch_idx);
+			if (!launch_watch(watch_idx)) {
+				// Still no room, keep waiting
+				break;
+			}
+		}
+
+		SpawnQueue.count--;
+		memmove(&SpawnQueue.requests[0],
+			&SpawnQueue.requests[1],
+			SpawnQueue.count * sizeof(*SpawnQueue.requests));
+	}
+}
+
+// Forget about everything we had queued
+static void
+    clear_spawn_queue(void)
+{
+	if (SpawnQueue.count > 0U) {
+		LOG(LOG_NOTICE, "Dropping %hhu queued launch request(s)", SpawnQueue.count);
+	}
+	SpawnQueue.count = 0U;
+}
+
+// Initializes the FBInk config
+static void
+    init_fbink_config(void)
+{
+	// NOTE: The struct is zero-initialized, so we only tweak what's non-default
+	//       (the defaults are explicitly designed to always be 0 for this very purpose).
+	fbinkConfig.row         = -5;
+	fbinkConfig.is_centered = true;
+	fbinkConfig.is_padded   = true;
+	// NOTE: For now, we *want* fbink_init's status report logged, so we leave this disabled.
+	// fbinkConfig.is_quiet = false;
+	// If we log to syslog, tell FBInk to do the same
+	if (daemonConfig.use_syslog) {
+		fbinkConfig.to_syslog = true;
+	}
+}
+
+// Figure out how we'll be reaping our spawns.
+// NOTE: Must be called before we start any other thread, as the signal mask is inherited.
+static void
+    init_reaper(void)
+{
+	// NOTE: Block SIGCHLD in every case: it's required for signalfd,
+	//       and it doesn't matter with pidfds, as its default disposition is to be ignored anyway.
+	//       Our children will unblock it before exec, c.f., spawn.
+	sigset_t mask;
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGCHLD);
+	if (sigprocmask(SIG_BLOCK, &mask, NULL) == -1) {
+		PFLOG(LOG_ERR, "Aborting: sigprocmask: %m");
+		fbink_print(FBFD_AUTO, "[KFMon] sigprocmask failed ?!", &fbinkConfig);
+		exit(EXIT_FAILURE);
+	}
+
+	// Check if the kernel supports pidfds (Linux 5.3+), by trying to get one for ourselves...
+	int pidfd = open_pidfd(getpid());
+	if (pidfd != -1) {
+		close(pidfd);
+		use_pidfd = true;
+		LOG(LOG_INFO, "Reaping our spawns via pidfds");
+		return;
+	}
+
+	// Otherwise, fall back to a signalfd for SIGCHLD
+	use_sigchld_fd();
+}
+
+// Reap our spawns via a signalfd for SIGCHLD from now on
+// NOTE: This catches the deaths of spawns we hold a pidfd for, too, c.f., handle_sigchld.
+static void
+    use_sigchld_fd(void)
+{
+	sigset_t mask;
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGCHLD);
+	sigchld_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+	if (sigchld_fd == -1) {
+		PFLOG(LOG_ERR, "Aborting: signalfd: %m");
+		fbink_print(FBFD_AUTO, "[KFMon] signalfd failed ?!", &fbinkConfig);
+		exit(EXIT_FAILURE);
+	}
+	add_event_source(sigchld_fd, EPOLLIN, handle_sigchld, 0U);
+	use_pidfd = false;
+	LOG(LOG_INFO, "Reaping our spawns via SIGCHLD");
+}
+
+// Returns a pidfd for the given process, or -1
+static int
+    open_pidfd(pid_t pid)
+{
+	// NOTE: pidfds are always CLOEXEC.
+	int pidfd = (int) syscall(SYS_pidfd_open, pid, 0U);
+	if (pidfd == -1 && errno != ENOSYS) {
+		PFLOG(LOG_WARNING, "pidfd_open: %m");
+	}
+	return pidfd;
+}
+
+// Log how one of our spawns died (and what it cost us, if we know), and remove it from the process table
+static void
+    reap_process(uint16_t i, int wstatus, const struct rusage* ru)
+{
+	pid_t    cpid      = PT.spawn_pids[i];
+	uint16_t watch_idx = (uint16_t) PT.spawn_watchids[i];
+
+	// NOTE: We'll potentially be printing stuff, so make sure we're up to date first...
+	fbink_reinit(FBFD_AUTO, &fbinkConfig);
+
+	if (WIFEXITED(wstatus)) {
+		int exitcode = WEXITSTATUS(wstatus);
+		LOG(LOG_NOTICE,
+		    "Reaped process %ld (from watch idx %hu): It exited with status %d.",
+		    (long) cpid,
+		    watch_idx,
+		    exitcode);
+		// NOTE: Ugly hack to try to salvage execvp's potential error...
+		//       If the process exited with a non-zero status code,
+		//       within (roughly) a second of being launched,
+		//       assume the exit code is actually inherited from execvp's errno...
+		struct timespec now = { 0 };
+		clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+		// NOTE: We should be okay not using difftime on Linux (We're using a monotonic clock, time_t is int64_t).
+		// NOTE: posix_spawn, on the other hand, may report exec failures via a 127 exit code (much like a shell),
+		//       when it's not recent enough to report them to us directly.
+		if (exitcode != 0 && (now.tv_sec - PT.spawn_times[i].tv_sec) <= 1) {
+			LOG(LOG_CRIT,
+			    "If nothing was visibly launched, and/or especially if status > 1, this *may* actually be an execvp() error: %s.",
+			    exitcode == 127 ? "command not found or not executable" : strerror(exitcode));
+			fbink_printf(FBFD_AUTO,
+				     NULL,
+				     &fbinkConfig,
+				     "[KFMon] PID %ld exited unexpectedly: %d!",
+				     (long) cpid,
+				     exitcode);
+		}
+	} else if (WIFSIGNALED(wstatus)) {
+		int sigcode = WTERMSIG(wstatus);
+		LOG(LOG_WARNING,
+		    "Reaped process %ld (from watch idx %hu): It was killed by signal %d (%s).",
+		    (long) cpid,
+		    watch_idx,
+		    sigcode,
+		    strsignal(sigcode));
+		fbink_printf(FBFD_AUTO,
+			     NULL,
+			     &fbinkConfig,
+			     "[KFMon] PID %ld was killed by signal %d!",
+			     (long) cpid,
+			     sigcode);
+	}
+
+	if (ru) {
+		record_spawn_usage(i, ru);
+	}
+
+	// And now we can safely remove it from the process table
+	remove_process_from_table(i);
+}
+
+// Convert a struct timeval to ms
+static uint64_t
+    timeval_to_ms(const struct timeval* tv)
+{
+	return (uint64_t) tv->tv_sec * 1000U + (uint64_t) tv->tv_usec / 1000U;
+}
+
+// Log what the spawn in that process table entry cost us, and account for it in its watch's stats
+// NOTE: That's what wait4 gave us, so, that includes whatever it reaped itself (e.g., what a shell script ran).
+static void
+    record_spawn_usage(uint16_t i, const struct rusage* ru)
+{
+	uint16_t        watch_idx = (uint16_t) PT.spawn_watchids[i];
+	struct timespec now       = { 0 };
+	clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+
+	int64_t    wall_ms = (int64_t) (now.tv_sec - PT.spawn_times[i].tv_sec) * 1000 +
+			     (now.tv_nsec - PT.spawn_times[i].tv_nsec) / 1000000L;
+	SpawnUsage usage   = { .wall_ms   = (uint64_t) wall_ms,
+			       .user_ms   = timeval_to_ms(&ru->ru_utime),
+			       .sys_ms    = timeval_to_ms(&ru->ru_stime),
+			       .maxrss_kb = (uint64_t) ru->ru_maxrss,
+			       .majflt    = (uint64_t) ru->ru_majflt,
+			       .minflt    = (uint64_t) ru->ru_minflt };
+	LOG(LOG_INFO,
+	    "Process %ld (from watch idx %hu) ran for %llums (user: %llums, sys: %llums), peaking at %llukB of RSS (page faults: %llu major, %llu minor)",
+	    (long) PT.spawn_pids[i],
+	    watch_idx,
+	    (unsigned long long) usage.wall_ms,
+	    (unsigned long long) usage.user_ms,
+	    (unsigned long long) usage.sys_ms,
+	    (unsigned long long) usage.maxrss_kb,
+	    (unsigned long long) usage.majflt,
+	    (unsigned long long) usage.minflt);
+
+	// NOTE: Its watch may have been dropped while it was running (and its slot even reused by another one since),
+	//       in which case, there's nothing left to account it to.
+	if (!is_spawn_watch_current(i)) {
+		return;
+	}
+	SpawnStats* stats      = &watchConfig[watch_idx].spawn_stats;
+	stats->last            = usage;
+	stats->total.maxrss_kb = MAX(stats->total.maxrss_kb, usage.maxrss_kb);
+	stats->total.wall_ms += usage.wall_ms;
+	stats->total.user_ms += usage.user_ms;
+	stats->total.sys_ms += usage.sys_ms;
+	stats->total.majflt += usage.majflt;
+	stats->total.minflt += usage.minflt;
+	stats->runs++;
+}
+
+// Is the watch the spawn in that process table entry was launched for still the one in that watch slot?
+static bool
+    is_spawn_watch_current(uint16_t i)
+{
+	uint16_t watch_idx = (uint16_t) PT.spawn_watchids[i];
+	return watchConfig[watch_idx].is_active &&
+	       strcmp(watchConfig[watch_idx].filename, &PT.spawn_filenames[i * CFG_SZ_MAX]) == 0;
+}
+
+// The pidfd of the spawn in that process table entry is readable, meaning it died: reap it.
+static bool
+    handle_pidfd(int fd __attribute__((unused)), uint32_t events __attribute__((unused)), uint32_t data)
+{
+	uint16_t i = (uint16_t) data;
+	if (PT.spawn_pids[i] == -1) {
+		// Already reaped
+		return false;
+	}
+
+	int           wstatus;
+	struct rusage ru;
+	pid_t         ret = wait4(PT.spawn_pids[i], &wstatus, WNOHANG, &ru);
+	if (ret == -1 && errno == ECHILD) {
+		// NOTE: That's one of the spawns our late zygote left behind, c.f., stop_zygote.
+		LOG(LOG_NOTICE,
+		    "Process %ld (from watch idx %d) is gone (its exit status went to init).",
+		    (long) PT.spawn_pids[i],
+		    PT.spawn_watchids[i]);
+		remove_process_from_table(i);
+	} else if (ret == -1) {
+		PFLOG(LOG_CRIT, "wait4: %m");
+		// NOTE: Don't keep a dead entry around, or we'd be busy-looping on its pidfd.
+		remove_process_from_table(i);
+	} else if (ret == PT.spawn_pids[i]) {
+		reap_process(i, wstatus, &ru);
+	}
+	// NOTE: ret == 0 means it's actually still running (i.e., that entry was recycled since we polled).
+	return false;
+}
+
+// We caught (at least) one SIGCHLD: reap every dead spawn.
+static bool
+    handle_sigchld(int fd, uint32_t events __attribute__((unused)), uint32_t data __attribute__((unused)))
+{
+	// Drain the signalfd (standard signals don't queue, so, there's at most one per batch of deaths)
+	struct signalfd_siginfo fdsi;
+	while (read(fd, &fdsi, sizeof(fdsi)) == sizeof(fdsi)) {    // Flawfinder: ignore
+		;
+	}
+
+	int           wstatus;
+	struct rusage ru;
+	pid_t         pid;
+	while ((pid = wait4(-1, &wstatus, WNOHANG, &ru)) > 0) {
+		// NOTE: Our zygote is our child, too, and we've just reaped it, so, make sure stop_zygote won't try to.
+		if (pid == zygote_pid) {
+			LOG(LOG_WARNING, "Our zygote died, we'll launch things ourselves from now on.");
+			zygote_pid = -1;
+			stop_zygote();
+			continue;
+		}
+		bool found = false;
+		for (uint16_t i = 0U; i < PT.size; i++) {
+			if (PT.spawn_pids[i] == pid) {
+				reap_process(i, wstatus, &ru);
+				found = true;
+				break;
+			}
+		}
+		if (!found) {
+			LOG(LOG_WARNING, "Reaped unknown process %ld", (long) pid);
+		}
+	}
+	if (pid == -1 && errno != ECHILD) {
+		PFLOG(LOG_CRIT, "wait4: %m");
+	}
+
+	return false;
+}
+
+// Launch a process via posix_spawn, and return its pid (or -1 on failure).
+// NOTE: glibc implements it via clone(CLONE_VM|CLONE_VFORK) (or vfork, c.f., POSIX_SPAWN_USEVFORK),
+//       which means we don't have to duplicate our page tables (SQLite's page cache, FBInk's fb mapping, ...),
+//       nor risk a flurry of CoW faults in the parent right when the child is starting up.
+static pid_t
+    posix_spawn_process(char* const* command)
+{
+	pid_t                      pid = -1;
+	int                        rc;
+	posix_spawn_file_actions_t file_actions;
+	posix_spawnattr_t          attr;
+
+	if ((rc = posix_spawn_file_actions_init(&file_actions)) != 0) {
+		PFLOG(LOG_WARNING, "posix_spawn_file_actions_init: %s", strerror(rc));
+		return -1;
+	}
+	if ((rc = posix_spawnattr_init(&attr)) != 0) {
+		PFLOG(LOG_WARNING, "posix_spawnattr_init: %s", strerror(rc));
+		posix_spawn_file_actions_destroy(&file_actions);
+		return -1;
+	}
+
+	// Do the whole stdin/stdout/stderr dance again,
+	// to ensure that child process doesn't inherit our tweaked fds...
+	if ((rc = posix_spawn_file_actions_adddup2(&file_actions, origStdin, fileno(stdin))) != 0 ||
+	    (rc = posix_spawn_file_actions_adddup2(&file_actions, origStdout, fileno(stdout))) != 0 ||
+	    (rc = posix_spawn_file_actions_adddup2(&file_actions, origStderr, fileno(stderr))) != 0 ||
+	    (rc = posix_spawn_file_actions_addclose(&file_actions, origStdin)) != 0 ||
+	    (rc = posix_spawn_file_actions_addclose(&file_actions, origStdout)) != 0 ||
+	    (rc = posix_spawn_file_actions_addclose(&file_actions, origStderr)) != 0) {
+		PFLOG(LOG_WARNING, "posix_spawn_file_actions: %s", strerror(rc));
+		goto cleanup;
+	}
+
+	// Restore signals (SIGHUP's disposition, as well as our signal mask, c.f., init_reaper)
+	// NOTE: POSIX_SPAWN_USEVFORK is a no-op on glibc >= 2.24, which always uses clone(CLONE_VM|CLONE_VFORK),
+	//       but older versions would otherwise use a plain fork, since we need file actions & signal tweaks.
+	sigset_t sigdefault;
+	sigemptyset(&sigdefault);
+	sigaddset(&sigdefault, SIGHUP);
+	sigset_t sigmask;
+	sigemptyset(&sigmask);
+	if ((rc = posix_spawnattr_setsigdefault(&attr, &sigdefault)) != 0 ||
+	    (rc = posix_spawnattr_setsigmask(&attr, &sigmask)) != 0 ||
+	    (rc = posix_spawnattr_setflags(
+		 &attr, POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_USEVFORK)) != 0) {
+		PFLOG(LOG_WARNING, "posix_spawnattr: %s", strerror(rc));
+		goto cleanup;
+	}
+
+	// NOTE: Much like with execvp in fork_process, we rely on the env we inherit from rcS/on-animator.
+	if ((rc = posix_spawnp(&pid, *command, &file_actions, &attr, command, environ)) != 0) {
+		PFLOG(LOG_WARNING, "posix_spawnp: %s", strerror(rc));
+		pid = -1;
+	}
+
+cleanup:
+	posix_spawnattr_destroy(&attr);
+	posix_spawn_file_actions_destroy(&file_actions);
+
+	return pid;
+}
+
+// Launch a process via a good ol' fork + execvp, and return its pid
+// Initially inspired from popen2() implementations from https://stackoverflow.com/questions/548063
+// As well as the glibc's system() call.
+// NOTE: That's also the only way to honor a watch's spawn policy, as we have to apply it between fork & exec.
+static pid_t
+    fork_process(char* const* command, uint16_t watch_idx)
+{
+	// NOTE: The cgroup has to be setup from here, as the child will be restricted to async-safe functions.
+	const SpawnPolicy* policy    = &watchConfig[watch_idx].policy;
+	int                cgroup_fd = -1;
+	if (is_spawn_cgroup_set(policy)) {
+		cgroup_fd = setup_spawn_cgroup(watch_idx);
+	}
+
+	pid_t pid = fork_and_exec(command, policy, cgroup_fd);
+
+	if (pid < 0) {
+		// Fork failed?
+		PFLOG(LOG_ERR, "Aborting: fork: %m");
+		fbink_print(FBFD_AUTO, "[KFMon] fork failed ?!", &fbinkConfig);
+		exit(EXIT_FAILURE);
+	}
+
+	if (cgroup_fd != -1) {
+		close(cgroup_fd);
+	}
+	return pid;
+}
+
+// Fork, and have the child apply a spawn policy to itself before exec'ing command. Returns its pid (or -1).
+// NOTE: cgroup_fd is the cgroup.procs file it should move itself to (c.f., setup_spawn_cgroup), or -1.
+//       Used by both fork_process and our zygote (c.f., run_zygote), which is why it doesn't log anything itself.
+static pid_t
+    fork_and_exec(char* const* command, const SpawnPolicy* policy, int cgroup_fd)
+{
+	// Prepare everything the child will need to apply our spawn policy *now*,
+	// as it'll be restricted to async-safe functions (c.f., below).
+	cpu_set_t cpus;
+	fill_spawn_cpu_set(policy, &cpus);
+	char oom_score_adj[16];
+	int  oom_len = snprintf(oom_score_adj, sizeof(oom_score_adj), "%d", policy->oom_score_adj);
+
+	pid_t pid = fork();
+
+	if (pid == 0) {
 		// Sweet child o' mine!
-		// NOTE: We're multithreaded & forking, this means that from this point on until execve(),
-		//       we can only use async-safe functions!
+		// NOTE: We're (usually, c.f., run_zygote) multithreaded & forking,
+		//       this means that from this point on until execve(), we can only use async-safe functions!
 		//       See pthread_atfork(3) for details.
 		// Do the whole stdin/stdout/stderr dance again,
 		// to ensure that child process doesn't inherit our tweaked fds...
@@ -1752,215 +4177,1158 @@ static pid_t
 		// Restore signals
 		struct sigaction sa = { .sa_handler = SIG_DFL, .sa_flags = SA_RESTART };
 		sigaction(SIGHUP, &sa, NULL);
+		sigset_t mask;
+		sigemptyset(&mask);
+		sigaddset(&mask, SIGCHLD);
+		sigprocmask(SIG_UNBLOCK, &mask, NULL);
+		// Apply our spawn policy, if any.
+		// NOTE: We can't report errors from here, and none of them are worth giving up on the launch, anyway.
+		if (cgroup_fd != -1) {
+			// NOTE: Writing 0 moves the writer itself.
+			if (write(cgroup_fd, "0", 1U) == -1) {
+				;
+			}
+			close(cgroup_fd);
+		}
+		if (policy->has_oom_score_adj) {
+			int fd = open("/proc/self/oom_score_adj", O_WRONLY | O_CLOEXEC);
+			if (fd != -1) {
+				if (write(fd, oom_score_adj, (size_t) oom_len) == -1) {
+					;
+				}
+				close(fd);
+			}
+		}
+		if (policy->has_nice) {
+			setpriority(PRIO_PROCESS, 0, policy->nice);
+		}
+		if (policy->ioprio != 0) {
+			syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, policy->ioprio);
+		}
+		if (policy->cpu_affinity != 0U) {
+			sched_setaffinity(0, sizeof(cpus), &cpus);
+		}
 		// NOTE: We used to use execvpe when being launched from udev,
 		//       in order to sanitize all the crap we inherited from udev's env ;).
 		//       Now, we actually rely on the specific env we inherit from rcS/on-animator!
 		execvp(*command, command);
 		// NOTE: This will only ever be reached on error, hence the lack of actual return value check ;).
 		//       Resort to an ugly hack by exiting with execvp()'s errno,
-		//       which we can then try to salvage in the reaper thread.
+		//       which we can then try to salvage in reap_process.
 		exit(errno);
-	} else {
-		// Parent
-		// Keep track of the process
-		int8_t i;
-		pthread_mutex_lock(&ptlock);
-		i = get_next_available_pt_entry();
-		pthread_mutex_unlock(&ptlock);
-
-		if (i < 0) {
-			// NOTE: If we ever hit this error codepath,
-			//       we don't have to worry about leaving that last spawn as a zombie:
-			//       One of the benefits of the double-fork we do to daemonize is that, on our death,
-			//       our children will get reparented to init, which, by design,
-			//       will handle the reaping automatically.
-			LOG(LOG_ERR,
-			    "Failed to find an available entry in our process table for pid %ld, aborting!",
-			    (long) pid);
-			fbink_print(FBFD_AUTO, "[KFMon] Can't spawn any more processes!", &fbinkConfig);
+	}
+
+	return pid;
+}
+
+// Write a value to one of a cgroup's interface files
+static bool
+    write_cgroup_file(const char* path, const char* value)
+{
+	int fd = open(path, O_WRONLY | O_CLOEXEC);
+	if (fd == -1) {
+		LOG(LOG_WARNING, "Failed to open cgroup file '%s': %m", path);
+		return false;
+	}
+	bool ok = write(fd, value, strlen(value)) != -1;
+	if (!ok) {
+		LOG(LOG_WARNING, "Failed to write '%s' to cgroup file '%s': %m", value, path);
+	}
+	close(fd);
+	return ok;
+}
+
+// Make sure a watch's cgroup exists, and enforces its limits.
+// Returns an fd to its cgroup.procs file (for the child to write itself to, c.f., fork_process), or -1.
+// NOTE: We need cgroup v2, mounted @ KFMON_CGROUP_ROOT. If that's not the case, the spawn just won't be confined.
+static int
+    setup_spawn_cgroup(uint16_t watch_idx)
+{
+	const SpawnPolicy* policy = &watchConfig[watch_idx].policy;
+
+	// Don't go creating directories on whatever else might be mounted there (e.g., the tmpfs of a v1 hierarchy)
+	struct statfs fs;
+	if (statfs(KFMON_CGROUP_ROOT, &fs) == -1 || fs.f_type != CGROUP2_SUPER_MAGIC) {
+		LOG(LOG_WARNING,
+		    "%s is not a cgroup v2 hierarchy, can't enforce memory_max/cpu_max for watch idx %hu!",
+		    KFMON_CGROUP_ROOT,
+		    watch_idx);
+		return -1;
+	}
+
+	// One per watch, named after its (unique) basename, under our own
+	char cgroup[PATH_MAX];
+	snprintf(cgroup, sizeof(cgroup), "%s/%s", KFMON_CGROUP_PATH, get_watch_basename(watch_idx));
+	if ((mkdir(KFMON_CGROUP_PATH, 0755) == -1 && errno != EEXIST) ||
+	    (mkdir(cgroup, 0755) == -1 && errno != EEXIST)) {
+		PFLOG(LOG_WARNING, "mkdir: %m");
+		return -1;
+	}
+
+	// Enable the controllers we need all the way down to it
+	// NOTE: Only leaves may hold processes once controllers are enabled, which is why we have our own parent.
+	char controllers[16];
+	snprintf(controllers,
+		 sizeof(controllers),
+		 "%s%s",
+		 *policy->memory_max ? "+memory " : "",
+		 *policy->cpu_max ? "+cpu" : "");
+	if (!write_cgroup_file(KFMON_CGROUP_ROOT "/cgroup.subtree_control", controllers) ||
+	    !write_cgroup_file(KFMON_CGROUP_PATH "/cgroup.subtree_control", controllers)) {
+		return -1;
+	}
+
+	char path[PATH_MAX];
+	if (*policy->memory_max) {
+		snprintf(path, sizeof(path), "%s/memory.max", cgroup);
+		if (!write_cgroup_file(path, policy->memory_max)) {
+			return -1;
+		}
+	}
+	if (*policy->cpu_max) {
+		snprintf(path, sizeof(path), "%s/cpu.max", cgroup);
+		if (!write_cgroup_file(path, policy->cpu_max)) {
+			return -1;
+		}
+	}
+
+	snprintf(path, sizeof(path), "%s/cgroup.procs", cgroup);
+	int fd = open(path, O_WRONLY | O_CLOEXEC);
+	if (fd == -1) {
+		LOG(LOG_WARNING, "Failed to open cgroup file '%s': %m", path);
+	}
+	return fd;
+}
+
+// Does that spawn policy ask for a cgroup (i.e., can it only be honored by fork_process, and not by our zygote)?
+static bool
+    is_spawn_cgroup_set(const SpawnPolicy* policy)
+{
+	return *policy->memory_max || *policy->cpu_max;
+}
+
+// Does that spawn policy ask for anything at all (i.e., can it not be honored by posix_spawn_process)?
+static bool
+    is_spawn_policy_set(const SpawnPolicy* policy)
+{
+	return policy->has_nice || policy->has_oom_score_adj || policy->ioprio != 0 || policy->cpu_affinity != 0U ||
+	       is_spawn_cgroup_set(policy);
+}
+
+// Convert a spawn policy's cpu_affinity bitmask to a cpu_set_t
+static void
+    fill_spawn_cpu_set(const SpawnPolicy* policy, cpu_set_t* cpus)
+{
+	CPU_ZERO(cpus);
+	for (unsigned int cpu = 0U; cpu < 32U; cpu++) {
+		if (policy->cpu_affinity & (1U << cpu)) {
+			CPU_SET(cpu, cpus);
+		}
+	}
+}
+
+// Spawn a process, returns false if we couldn't keep track of it (in which case nothing was launched)...
+// With a bit of added tracking to handle reaping without a SIGCHLD handler (c.f., init_reaper).
+static bool
+    spawn(char* const* command, uint16_t watch_idx)
+{
+	// Make sure we'll be able to keep track of the process *before* launching it
+	int32_t i = get_next_available_pt_entry();
+	if (i < 0) {
+		// NOTE: The caller can try again later, c.f., queue_spawn.
+		LOG(LOG_ERR, "Failed to find an available entry in our process table for watch idx %hu!", watch_idx);
+		return false;
+	}
+
+	// Prefer our zygote if we have one, in which case we'll only know its pid once it answers
+	// (c.f., handle_zygote_reply).
+	// NOTE: If the watch needs its own cgroup, we can only launch it ourselves, c.f., fork_process.
+	const SpawnPolicy* policy = &watchConfig[watch_idx].policy;
+	if (zygote_fd != -1 && !is_spawn_cgroup_set(policy) && zygote_spawn(command, (uint16_t) i, policy)) {
+		add_process_to_table((uint16_t) i, 0, watch_idx, true);
+		return true;
+	}
+
+	spawn_directly((uint16_t) i, command, watch_idx);
+	return true;
+}
+
+// Launch a process ourselves, and keep track of it in that (available) process table entry
+static void
+    spawn_directly(uint16_t i, char* const* command, uint16_t watch_idx)
+{
+	// Prefer posix_spawn, and fall back to fork if it failed for any reason
+	// (in which case errors will be caught by the exit code heuristic in reap_process).
+	// NOTE: If the watch has a spawn policy, we can only honor it via fork, c.f., fork_process.
+	bool  use_fork = is_spawn_policy_set(&watchConfig[watch_idx].policy);
+	pid_t pid      = use_fork ? -1 : posix_spawn_process(command);
+	if (pid == -1) {
+		pid = fork_process(command, watch_idx);
+	}
+
+	// Keep track of the process
+	add_process_to_table(i, pid, watch_idx, false);
+	report_spawn(i);
+
+	// NOTE: We achieve reaping in a non-blocking way by polling its pidfd from the main loop,
+	//       (or the signalfd for SIGCHLD, on older kernels).
+	//       See #2 for an history of the previous failed attempts...
+	//       If we somehow failed to get a pidfd, switch to SIGCHLD for good,
+	//       as that's our only way to make sure it won't linger as a zombie.
+	if (use_pidfd && PT.spawn_pidfds[i] == -1) {
+		use_sigchld_fd();
+	}
+}
+
+// Let the world know about the spawn in that process table entry, now that we know its pid
+static void
+    report_spawn(uint16_t i)
+{
+	uint16_t watch_idx = (uint16_t) PT.spawn_watchids[i];
+
+	DBGLOG("Assigned pid %ld (from watch idx %hu) to process table entry idx %hu",
+	       (long) PT.spawn_pids[i],
+	       watch_idx,
+	       i);
+	// NOTE: We can't do that from the child proper, because it's not async-safe,
+	//       so do it from here.
+	LOG(LOG_NOTICE,
+	    "Spawned process %ld (%s -> %s @ watch idx %hu) . . .",
+	    (long) PT.spawn_pids[i],
+	    watchConfig[watch_idx].filename,
+	    watchConfig[watch_idx].action,
+	    watch_idx);
+	if (daemonConfig.with_notifications) {
+		fbink_printf(FBFD_AUTO,
+			     NULL,
+			     &fbinkConfig,
+			     "[KFMon] Launched %s :)",
+			     basename(watchConfig[watch_idx].action));
+	}
+}
+
+// Fork our zygote, which will launch our spawns on our behalf from now on
+// NOTE: Must be called before we initialize anything heavy (SQLite, FBInk, threads...),
+//       the whole point being that it stays small. If anything goes wrong, we'll just launch things ourselves.
+static void
+    start_zygote(void)
+{
+	int sv[2];
+	if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) == -1) {
+		PFLOG(LOG_WARNING, "socketpair: %m");
+		return;
+	}
+
+	pid_t pid = fork();
+	if (pid == -1) {
+		PFLOG(LOG_WARNING, "fork: %m");
+		close(sv[0]);
+		close(sv[1]);
+		return;
+	} else if (pid == 0) {
+		close(sv[0]);
+		// NOTE: That's the only other thing we've got open at this point, and the zygote doesn't need it.
+		close(MountMon.fd);
+		run_zygote(sv[1]);
+	}
+
+	close(sv[1]);
+	// NOTE: Non-blocking, as it'll be part of our event loop.
+	int flags = fcntl(sv[0], F_GETFL);
+	if (flags == -1 || fcntl(sv[0], F_SETFL, flags | O_NONBLOCK) == -1) {
+		PFLOG(LOG_WARNING, "fcntl: %m");
+	}
+	zygote_pid = pid;
+	zygote_fd  = sv[0];
+	LOG(LOG_INFO, "Started our zygote (pid %ld)", (long) pid);
+}
+
+// The zygote's main loop: launch whatever we're asked to, and report on it
+// NOTE: We're the fresh fork of a single-threaded process, so, unlike in fork_process, we can do pretty much anything.
+static void
+    run_zygote(int fd)
+{
+	// We reap our spawns ourselves, via a signalfd for SIGCHLD (c.f., use_sigchld_fd)
+	sigset_t mask;
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGCHLD);
+	int sfd = -1;
+	if (sigprocmask(SIG_BLOCK, &mask, NULL) == -1 || (sfd = signalfd(-1, &mask, SFD_CLOEXEC)) == -1) {
+		PFLOG(LOG_ERR, "Zygote failed to setup a signalfd: %m");
+		_exit(EXIT_FAILURE);
+	}
+
+	struct pollfd pfds[2] = { { .fd = fd, .events = POLLIN }, { .fd = sfd, .events = POLLIN } };
+	while (1) {
+		if (poll(pfds, 2, -1) == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			PFLOG(LOG_ERR, "Zygote failed to poll: %m");
+			_exit(EXIT_FAILURE);
+		}
+
+		if (pfds[1].revents & POLLIN) {
+			struct signalfd_siginfo fdsi;
+			if (read(sfd, &fdsi, sizeof(fdsi)) == -1) {    // Flawfinder: ignore
+				PFLOG(LOG_WARNING, "read: %m");
+			}
+			ZygoteReply reply = { .type = ZYGOTE_REAPED };
+			while ((reply.pid = wait4(-1, &reply.wstatus, WNOHANG, &reply.rusage)) > 0) {
+				send(fd, &reply, sizeof(reply), MSG_NOSIGNAL);
+			}
+		}
+
+		if (pfds[0].revents & POLLIN) {
+			ZygoteRequest req;
+			ssize_t       len = recv(fd, &req, sizeof(req), 0);
+			if (len == 0) {
+				// KFMon is gone, and so are we (our spawns will be reparented to init).
+				break;
+			}
+			if (len != (ssize_t) sizeof(req)) {
+				continue;
+			}
+			req.action[sizeof(req.action) - 1U] = '\0';
+
+			// NOTE: Much like spawn_directly, we can only honor a spawn policy via fork
+			//       (which is cheap enough here, that's the whole point of this process).
+			char* const cmd[] = { req.action, NULL };
+			ZygoteReply reply = { .type = ZYGOTE_SPAWNED, .entry = req.entry };
+			if (is_spawn_policy_set(&req.policy)) {
+				reply.pid = fork_and_exec(cmd, &req.policy, -1);
+				if (reply.pid == -1) {
+					PFLOG(LOG_WARNING, "fork: %m");
+				}
+			} else {
+				reply.pid = posix_spawn_process(cmd);
+			}
+			send(fd, &reply, sizeof(reply), MSG_NOSIGNAL);
+		} else if (pfds[0].revents & (POLLHUP | POLLERR)) {
+			break;
+		}
+	}
+
+	_exit(EXIT_SUCCESS);
+}
+
+// Ask our zygote to launch something (following that spawn policy) on behalf of that (reserved) process table entry.
+// Returns false if we couldn't, in which case we're done with it.
+// NOTE: We don't wait for its answer, that'll come through our event loop (c.f., handle_zygote).
+static bool
+    zygote_spawn(char* const* command, uint16_t i, const SpawnPolicy* policy)
+{
+	ZygoteRequest req = { .entry = i, .policy = *policy };
+	str5cpy(req.action, sizeof(req.action), *command, CFG_SZ_MAX, TRUNC);
+	if (send(zygote_fd, &req, sizeof(req), MSG_NOSIGNAL) != (ssize_t) sizeof(req)) {
+		PFLOG(LOG_WARNING, "send: %m");
+		stop_zygote();
+		return false;
+	}
+
+	// NOTE: Only start the clock if it wasn't already running for an earlier request.
+	if (zygote_pending++ == 0U) {
+		arm_zygote_timer();
+	}
+	return true;
+}
+
+// (Re)start the clock on our zygote if it has requests left to answer, stop it otherwise
+static void
+    arm_zygote_timer(void)
+{
+	if (zygote_timer_fd == -1) {
+		zygote_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+		if (zygote_timer_fd == -1) {
+			// NOTE: We'll still notice if it dies, we just won't notice if it gets stuck.
+			PFLOG(LOG_WARNING, "timerfd_create: %m");
+			return;
+		}
+		add_event_source(zygote_timer_fd, EPOLLIN, handle_zygote_timeout, 0U);
+	}
+
+	struct itimerspec deadline = { 0 };
+	if (zygote_pending > 0U) {
+		deadline.it_value.tv_sec  = KFMON_ZYGOTE_TIMEOUT / 1000;
+		deadline.it_value.tv_nsec = (KFMON_ZYGOTE_TIMEOUT % 1000) * 1000000L;
+	}
+	if (timerfd_settime(zygote_timer_fd, 0, &deadline, NULL) == -1) {
+		PFLOG(LOG_WARNING, "timerfd_settime: %m");
+	}
+}
+
+// Act on something our zygote told us
+static void
+    handle_zygote_reply(const ZygoteReply* reply)
+{
+	if (reply->type == ZYGOTE_SPAWNED) {
+		uint16_t i = reply->entry;
+		if (i >= PT.size || !PT.spawn_via_zygote[i] || PT.spawn_pids[i] != 0) {
+			LOG(LOG_WARNING, "Unexpected reply from our zygote (pid %ld)", (long) reply->pid);
+			return;
+		}
+		zygote_pending--;
+		arm_zygote_timer();
+
+		if (reply->pid == -1) {
+			LOG(LOG_WARNING,
+			    "Our zygote failed to launch the action of watch idx %d, trying ourselves",
+			    PT.spawn_watchids[i]);
+			respawn_directly(i);
+			return;
+		}
+
+		PT.spawn_pids[i] = reply->pid;
+		report_spawn(i);
+		return;
+	}
+
+	for (uint16_t i = 0U; i < PT.size; i++) {
+		if (PT.spawn_pids[i] == reply->pid) {
+			reap_process(i, reply->wstatus, &reply->rusage);
+			return;
+		}
+	}
+	LOG(LOG_WARNING, "Our zygote reaped unknown process %ld", (long) reply->pid);
+}
+
+// Our zygote has something to tell us (or it died)
+static bool
+    handle_zygote(int fd, uint32_t events, uint32_t data __attribute__((unused)))
+{
+	ZygoteReply reply;
+	ssize_t     len;
+	while ((len = recv(fd, &reply, sizeof(reply), 0)) == (ssize_t) sizeof(reply)) {
+		handle_zygote_reply(&reply);
+	}
+
+	if (len == 0 || (events & (EPOLLHUP | EPOLLERR))) {
+		LOG(LOG_WARNING, "Our zygote died, we'll launch things ourselves from now on.");
+		stop_zygote();
+	}
+	return false;
+}
+
+// Our zygote is taking too long to answer a spawn request, assume it's stuck
+static bool
+    handle_zygote_timeout(int fd __attribute__((unused)),
+			  uint32_t events __attribute__((unused)),
+			  uint32_t data __attribute__((unused)))
+{
+	LOG(LOG_WARNING, "Our zygote isn't answering anymore, we'll launch things ourselves from now on.");
+	stop_zygote();
+	return false;
+}
+
+// Launch ourselves what we had asked our zygote to in that process table entry
+// NOTE: Unless its watch was dropped in the meantime, in which case we just forget about it.
+static void
+    respawn_directly(uint16_t i)
+{
+	uint16_t watch_idx = (uint16_t) PT.spawn_watchids[i];
+	bool     relaunch  = is_spawn_watch_current(i);
+	remove_process_from_table(i);
+	if (relaunch) {
+		char* const cmd[] = { watchConfig[watch_idx].action, NULL };
+		spawn_directly(i, cmd, watch_idx);
+	}
+}
+
+// Stop using our zygote (because it died, or stopped answering)
+static void
+    stop_zygote(void)
+{
+	if (zygote_fd == -1) {
+		return;
+	}
+	remove_event_source(zygote_fd);
+	close(zygote_fd);
+	zygote_fd = -1;
+	if (zygote_timer_fd != -1) {
+		remove_event_source(zygote_timer_fd);
+		close(zygote_timer_fd);
+		zygote_timer_fd = -1;
+	}
+	zygote_pending = 0U;
+	// NOTE: We may be giving up on it because it stopped answering (e.g., it's stuck in posix_spawn),
+	//       so, don't rely on it noticing that we closed our end: make sure it's gone before we wait for it.
+	//       It's our child, so, don't leave it as a zombie.
+	//       Unless it was already reaped via SIGCHLD (c.f., handle_sigchld),
+	//       in which case its pid may since have been recycled, and we must not touch it at all.
+	if (zygote_pid != -1) {
+		if (kill(zygote_pid, SIGKILL) == -1 && errno != ESRCH) {
+			PFLOG(LOG_WARNING, "kill: %m");
+		}
+		if (waitpid(zygote_pid, NULL, 0) == -1 && errno != ECHILD) {
+			PFLOG(LOG_WARNING, "waitpid: %m");
+		}
+		zygote_pid = -1;
+	}
+
+	// Whatever we were still waiting on it for, we'll have to launch ourselves.
+	// NOTE: It may actually have launched some of these before going down, but we'll never know their pids.
+	for (uint16_t i = 0U; i < PT.size; i++) {
+		if (PT.spawn_pids[i] != 0 || !PT.spawn_via_zygote[i]) {
+			continue;
+		}
+
+		respawn_directly(i);
+	}
+
+	// Nobody is left to reap what it launched (that's init's job now),
+	// but we can still tell when these die via pidfds.
+	// NOTE: Otherwise, at least don't let them block anything forever...
+	//       Our own children are none of our concern here, they'll be reaped as usual.
+	for (uint16_t i = 0U; i < PT.size; i++) {
+		if (PT.spawn_pids[i] == -1 || !PT.spawn_via_zygote[i]) {
+			continue;
+		}
+
+		PT.spawn_via_zygote[i] = false;
+		PT.spawn_pidfds[i]     = use_pidfd ? open_pidfd(PT.spawn_pids[i]) : -1;
+		if (PT.spawn_pidfds[i] != -1) {
+			add_event_source(PT.spawn_pidfds[i], EPOLLIN, handle_pidfd, i);
+		} else {
+			LOG(LOG_WARNING,
+			    "Forgetting about process %ld (from watch idx %d), as we can't keep track of it anymore",
+			    (long) PT.spawn_pids[i],
+			    PT.spawn_watchids[i]);
+			remove_process_from_table(i);
+		}
+	}
+}
+
+// Check if a given inotify watch already has a spawn running
+static bool
+    is_watch_already_spawned(uint16_t watch_idx)
+{
+	// NOTE: Assume everything's peachy,
+	//       and we'll never end up with the same watch_idx assigned to multiple indices in the process table.
+	return watch_idx < PT.watch_slots_size && PT.watch_slots[watch_idx] != -1;
+}
+
+// Check if a watch flagged as a spawn blocker (e.g., KOReader or Plato) is already running
+// NOTE: This is mainly to prevent spurious spawns that might be unwittingly caused by their file manager
+//       (be it through metadata reading, thumbnails creation, or whatever).
+//       Another workaround is of course to kill KFMon as part of their startup process...
+static bool
+    is_blocker_running(void)
+{
+	// NOTE: Kept up to date as spawns come and go, and as their configs change (c.f., update_spawn_blocker).
+	return PT.blockers > 0U;
+}
+
+// Check if spawns are inhibited by the global block file
+static bool
+    are_spawns_blocked(void)
+{
+	const char block_path[] = KFMON_CONFIGPATH "/BLOCK";
+	if (access(block_path, F_OK) == 0) {
+		// Global block file is here, prevent new spawns...
+		return true;
+	}
+
+	return false;
+}
+
+// Return the pid of the spawn of a given inotify watch
+static pid_t
+    get_spawn_pid_for_watch(uint16_t watch_idx)
+{
+	if (!is_watch_already_spawned(watch_idx)) {
+		return -1;
+	}
+
+	return PT.spawn_pids[PT.watch_slots[watch_idx]];
+}
+
+// Returns the length of the path to a watch's parent directory (minus the trailing slash, unless that's the root)
+static size_t
+    get_watch_dir_len(uint16_t watch_idx)
+{
+	return watchConfig[watch_idx].basename_ofs > 1U ? watchConfig[watch_idx].basename_ofs - 1U : 1U;
+}
+
+// Is that watch's target file in that directory?
+static bool
+    is_watch_in_dir(uint16_t watch_idx, uint16_t dir_idx)
+{
+	size_t len = get_watch_dir_len(watch_idx);
+	return strncmp(watchDirs[dir_idx].path, watchConfig[watch_idx].filename, len) == 0 &&
+	       watchDirs[dir_idx].path[len] == '\0';
+}
+
+// Returns the index of the watched directory holding that watch's target file, or -1
+// NOTE: That's a linear search, but there's usually a single one of those (the root of the target mountpoint) ;).
+static int32_t
+    find_watch_dir(uint16_t watch_idx)
+{
+	for (uint16_t dir_idx = 0U; dir_idx < watchDirsCount; dir_idx++) {
+		if (is_watch_in_dir(watch_idx, dir_idx)) {
+			return (int32_t) dir_idx;
+		}
+	}
+	return -1;
+}
+
+// Returns the index of the watched directory with that inotify wd, or -1
+static int32_t
+    find_watch_dir_by_wd(int wd)
+{
+	for (uint16_t dir_idx = 0U; dir_idx < watchDirsCount; dir_idx++) {
+		if (watchDirs[dir_idx].wd == wd) {
+			return (int32_t) dir_idx;
+		}
+	}
+	return -1;
+}
+
+// Make sure the inotify instance we're about to create gets a roomy event queue, if we're allowed to
+// NOTE: That's a system-wide setting, which only applies to the instances created afterwards.
+static void
+    raise_inotify_queue_size(void)
+{
+	FILE* f = fopen("/proc/sys/fs/inotify/max_queued_events", "r+e");
+	if (!f) {
+		PFLOG(LOG_WARNING, "fopen: %m");
+		return;
+	}
+
+	unsigned long int size = 0UL;
+	if (fscanf(f, "%lu", &size) == 1 && size < KFMON_INOTIFY_QUEUE_SIZE) {
+		rewind(f);
+		if (fprintf(f, "%u\n", KFMON_INOTIFY_QUEUE_SIZE) < 0 || fflush(f) != 0) {
+			PFLOG(LOG_WARNING, "Failed to raise the inotify queue size: %m");
+		} else {
+			LOG(LOG_INFO, "Raised the inotify queue size from %lu to %u events", size, KFMON_INOTIFY_QUEUE_SIZE);
+		}
+	}
+	fclose(f);
+}
+
+// Setup an inotify watch for each distinct parent directory of our target files that doesn't have one (yet, or anymore)
+// NOTE: Events are then matched to a watch by their name, c.f., handle_events.
+//       This means that a target file being deleted, replaced or created doesn't cost us anything,
+//       as the directory watch itself survives all of that.
+static void
+    arm_watch_dirs(void)
+{
+	// NOTE: We can't need more directories than we have watches, so, that's all the room we'll ever need.
+	if (watchDirsSize < watchListSize) {
+		WatchDir* new_dirs = realloc(watchDirs, watchListSize * sizeof(*new_dirs));
+		if (new_dirs == NULL) {
+			PFLOG(LOG_ERR, "Aborting: realloc: %m");
+			fbink_print(FBFD_AUTO, "[KFMon] OOM ?!", &fbinkConfig);
 			exit(EXIT_FAILURE);
+		}
+		watchDirs     = new_dirs;
+		watchDirsSize = watchListSize;
+	}
+
+	// Recount the active watches living in each directory, picking up new directories along the way
+	for (uint16_t dir_idx = 0U; dir_idx < watchDirsCount; dir_idx++) {
+		watchDirs[dir_idx].refs = 0U;
+	}
+	for (uint16_t watch_idx = 0U; watch_idx < watchListSize; watch_idx++) {
+		if (!watchConfig[watch_idx].is_active) {
+			continue;
+		}
+
+		int32_t match = find_watch_dir(watch_idx);
+		if (match < 0) {
+			WatchDir* dir = &watchDirs[watchDirsCount];
+			snprintf(dir->path,
+				 sizeof(dir->path),
+				 "%.*s",
+				 (int) get_watch_dir_len(watch_idx),
+				 watchConfig[watch_idx].filename);
+			dir->wd   = -1;
+			dir->refs = 0U;
+			match     = watchDirsCount++;
+		}
+		watchDirs[match].refs++;
+	}
+
+	// Drop the directories we no longer have any business in
+	for (uint16_t dir_idx = 0U; dir_idx < watchDirsCount;) {
+		if (watchDirs[dir_idx].refs > 0U) {
+			dir_idx++;
+			continue;
+		}
+
+		if (watchDirs[dir_idx].wd > 0) {
+			LOG(LOG_INFO, "Trying to remove inotify watch for directory '%s'.", watchDirs[dir_idx].path);
+			if (inotify_rm_watch(inotify_fd, watchDirs[dir_idx].wd) == -1) {
+				// That's too bad, but may not be fatal (e.g., it may already be gone), so warn only...
+				PFLOG(LOG_WARNING, "inotify_rm_watch: %m");
+			}
+		}
+		// Order doesn't matter, so, just move the last one in its place
+		watchDirs[dir_idx] = watchDirs[--watchDirsCount];
+	}
+
+	// And watch the ones that aren't armed already
+	for (uint16_t dir_idx = 0U; dir_idx < watchDirsCount; dir_idx++) {
+		if (watchDirs[dir_idx].wd > 0) {
+			continue;
+		}
+
+		// NOTE: Same events as in arm_watches, and the same reasoning applies.
+		//       We'll also get those for the directory itself (e.g., when it's listed), c.f., handle_events.
+		watchDirs[dir_idx].wd =
+		    inotify_add_watch(inotify_fd, watchDirs[dir_idx].path, IN_OPEN | IN_CLOSE | IN_ONLYDIR);
+		if (watchDirs[dir_idx].wd == -1) {
+			// NOTE: Much like in arm_watches, we keep those watches around as IPC-only ones,
+			//       but since we're not watching a specific file, there's nothing to release:
+			//       we'll simply try again the next time we go through the main loop.
+			if (errno == ENOENT) {
+				LOG(LOG_NOTICE,
+				    "Setup IPC-only watches for the %hu target file(s) in '%s'.",
+				    watchDirs[dir_idx].refs,
+				    watchDirs[dir_idx].path);
+			} else {
+				PFLOG(LOG_WARNING, "inotify_add_watch: %m");
+				LOG(LOG_WARNING,
+				    "Cannot watch directory '%s', its %hu target file(s) will be IPC-only!",
+				    watchDirs[dir_idx].path,
+				    watchDirs[dir_idx].refs);
+				fbink_printf(FBFD_AUTO, NULL, &fbinkConfig, "[KFMon] Failed to watch %s!", watchDirs[dir_idx].path);
+			}
 		} else {
-			pthread_mutex_lock(&ptlock);
-			add_process_to_table((uint8_t) i, pid, watch_idx);
-			pthread_mutex_unlock(&ptlock);
-
-			DBGLOG("Assigned pid %ld (from watch idx %hhu) to process table entry idx %hhd",
-			       (long) pid,
-			       watch_idx,
-			       i);
-			// NOTE: We can't do that from the child proper, because it's not async-safe,
-			//       so do it from here.
 			LOG(LOG_NOTICE,
-			    "Spawned process %ld (%s -> %s @ watch idx %hhu) . . .",
-			    (long) pid,
-			    watchConfig[watch_idx].filename,
-			    watchConfig[watch_idx].action,
-			    watch_idx);
-			if (daemonConfig.with_notifications) {
+			    "Setup an inotify watch for directory '%s' (for %hu target file(s)).",
+			    watchDirs[dir_idx].path,
+			    watchDirs[dir_idx].refs);
+		}
+	}
+}
+
+// Setup an inotify watch for each of our target files that doesn't have one (yet, or anymore)
+// NOTE: Our inotify instance outlives the main loop's iterations, so, watches that are still alive are left alone,
+//       and a watch that was destroyed (or removed, c.f., disarm_watch) only costs us a single inotify_add_watch.
+static void
+    arm_watches(void)
+{
+	if (fanotify_fd != -1 && arm_fanotify()) {
+		return;
+	}
+	if (daemonConfig.watch_directories) {
+		arm_watch_dirs();
+		return;
+	}
+
+	// Flag each of our target files for 'file was opened' and 'file was closed' events
+	// NOTE: We don't check for:
+	//       IN_MODIFY: Highly unlikely (and sandwiched between an OPEN and a CLOSE anyway)
+	//       IN_CREATE: Only applies to directories
+	//       IN_DELETE: Only applies to directories
+	//       IN_DELETE_SELF: Will trigger an IN_IGNORED, which we already handle
+	//       IN_MOVE_SELF: Highly unlikely on a Kobo, and somewhat annoying to handle with our design
+	//           (we'd have to forget about it entirely and not try to re-watch for it
+	//           on the next iteration of the loop).
+	// NOTE: inotify tracks the file's inode, which means that it goes *through* bind mounts, for instance:
+	//           When bind-mounting file 'a' to file 'b', and setting up a watch to the path of file 'b',
+	//           you won't get *any* event on that watch when unmounting that bind mount, since the original
+	//           file 'a' hasn't actually been touched, and, as it is the actual, real file,
+	//           that is what inotify is actually tracking.
+	//       Relative to the earlier IN_MOVE_SELF mention, that means it'll keep tracking the file with its
+	//           new name (provided it was moved to the *same* fs,
+	//           as crossing a fs boundary will delete the original).
+	for (uint16_t watch_idx = 0U; watch_idx < watchListSize; watch_idx++) {
+		// We obviously only care about active watches, and only those that aren't armed already
+		if (!watchConfig[watch_idx].is_active || watchConfig[watch_idx].inotify_wd > 0) {
+			continue;
+		}
+
+		set_watch_wd(watch_idx,
+			     inotify_add_watch(inotify_fd, watchConfig[watch_idx].filename, IN_OPEN | IN_CLOSE));
+		if (watchConfig[watch_idx].inotify_wd == -1) {
+			// NOTE: Allow running without an actual inotify watch, keeping the action IPC only...
+			//       We could limit this behavior to !hidden watches, or hide it behind another config flag,
+			//       but it's harmless enough to do it unconditionally ;).
+			//       The watch will be released properly if the *config* file gets removed.
+			if (errno == ENOENT) {
+				// Only account for ENOENT, though ;) (i.e., filename is gone).
+				LOG(LOG_NOTICE,
+				    "Setup an IPC-only watch for '%s' @ index %hu.",
+				    basename(watchConfig[watch_idx].filename),
+				    watch_idx);
+			} else {
+				PFLOG(LOG_WARNING, "inotify_add_watch: %m");
+				LOG(LOG_WARNING, "Cannot watch '%s', discarding it!", watchConfig[watch_idx].filename);
 				fbink_printf(FBFD_AUTO,
 					     NULL,
 					     &fbinkConfig,
-					     "[KFMon] Launched %s :)",
-					     basename(watchConfig[watch_idx].action));
-			}
-			// NOTE: We achieve reaping in a non-blocking way by doing the reaping from a dedicated thread
-			//       for every spawn...
-			//       See #2 for an history of the previous failed attempts...
-			pthread_t rthread;
-			uint8_t*  arg = malloc(sizeof(*arg));
-			if (arg == NULL) {
-				LOG(LOG_ERR, "Couldn't allocate memory for thread arg, aborting!");
-				fbink_print(FBFD_AUTO, "[KFMon] OOM ?!", &fbinkConfig);
-				exit(EXIT_FAILURE);
+					     "[KFMon] Failed to watch %s!",
+					     basename(watchConfig[watch_idx].filename));
+				// NOTE: We used to abort entirely in case even one target file couldn't be watched,
+				//       but that was a bit harsh ;).
+				//       Since the inotify watch couldn't be setup,
+				//       there's no way for this to cause trouble down the road,
+				//       and this allows the user to fix it during an USBMS session,
+				//       instead of having to reboot.
+
+				// If that watch isn't currently running, clear it entirely!
+				bool is_watch_spawned = is_watch_already_spawned(watch_idx);
+				if (is_watch_spawned) {
+					LOG(LOG_WARNING,
+					    "Cannot release watch slot %hu (%s => %s), as it's currently running!",
+					    watch_idx,
+					    basename(watchConfig[watch_idx].filename),
+					    basename(watchConfig[watch_idx].action));
+				} else {
+					unregister_watch(watch_idx);
+					watchConfig[watch_idx] = (const WatchConfig){ 0 };
+					// NOTE: This should essentially come down to:
+					//memset(&watchConfig[watch_idx], 0, sizeof(WatchConfig));
+					LOG(LOG_NOTICE, "Released watch slot %hu.", watch_idx);
+				}
 			}
-			*arg = (uint8_t) i;
+		} else {
+			LOG(LOG_NOTICE,
+			    "Setup an inotify watch for '%s' @ index %hu.",
+			    watchConfig[watch_idx].filename,
+			    watch_idx);
+		}
+	}
+}
 
-			// NOTE: We will *never* wait for one of these threads to die from the main thread, so,
-			//       start them in detached state
-			//       to make sure their resources will be released when they terminate.
-			pthread_attr_t attr;
-			if (pthread_attr_init(&attr) != 0) {
-				PFLOG(LOG_ERR, "Aborting: pthread_attr_init: %m");
-				fbink_print(FBFD_AUTO, "[KFMon] pthread_attr_init failed ?!", &fbinkConfig);
-				exit(EXIT_FAILURE);
-			}
-			if (pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED) != 0) {
-				PFLOG(LOG_ERR, "Aborting: pthread_attr_setdetachstate: %m");
-				fbink_print(FBFD_AUTO, "[KFMon] pthread_attr_setdetachstate failed ?!", &fbinkConfig);
-				exit(EXIT_FAILURE);
-			}
+// Remove a watch's inotify watch (if it has one), before its slot is released
+// NOTE: The kernel will then send us an IN_IGNORED for that wd, which handle_events knows to drop.
+static void
+    disarm_watch(uint16_t watch_idx)
+{
+	if (watchConfig[watch_idx].inotify_wd <= 0) {
+		return;
+	}
 
-			// NOTE: Use a smaller stack (ulimit -s is 8MB on the Kobos).
-			//       Base it on pointer size, aiming for 1MB on x64 (meaning 512KB on x86/arm).
-			//       Floor it at 512KB to be safe, though.
-			//       In the grand scheme of things, this won't really change much ;).
-			if (pthread_attr_setstacksize(
-				&attr, MAX((1U * 1024U * 1024U) / 2U, (sizeof(void*) * 1024U * 1024U) / 8U)) != 0) {
-				PFLOG(LOG_ERR, "Aborting: pthread_attr_setstacksize: %m");
-				fbink_print(FBFD_AUTO, "[KFMon] pthread_attr_setstacksize failed ?!", &fbinkConfig);
-				exit(EXIT_FAILURE);
+	LOG(LOG_INFO, "Trying to remove inotify watch for '%s' @ index %hu.", watchConfig[watch_idx].filename, watch_idx);
+	if (inotify_rm_watch(inotify_fd, watchConfig[watch_idx].inotify_wd) == -1) {
+		// That's too bad, but may not be fatal (e.g., it may already be gone), so warn only...
+		PFLOG(LOG_WARNING, "inotify_rm_watch: %m");
+	}
+	// Either way, we're done with it.
+	set_watch_wd(watch_idx, -1);
+}
+
+// Forget about every inotify watch we have, as they're already gone (i.e., after an unmount)
+static void
+    forget_all_watches(void)
+{
+	mountpoint_wd = -1;
+	for (uint16_t dir_idx = 0U; dir_idx < watchDirsCount; dir_idx++) {
+		watchDirs[dir_idx].wd = -1;
+	}
+	for (uint16_t watch_idx = 0U; watch_idx < watchListSize; watch_idx++) {
+		if (watchConfig[watch_idx].inotify_wd > 0) {
+			set_watch_wd(watch_idx, -1);
+		}
+	}
+}
+
+// Re-add an inotify watch we think we have, returning its (potentially new) wd, or -1 if its target is gone
+// NOTE: If nothing changed, inotify simply hands us back the same wd.
+static int
+    revalidate_wd(int wd, const char* path, uint32_t mask)
+{
+	int new_wd = inotify_add_watch(inotify_fd, path, mask);
+	if (new_wd == wd) {
+		return wd;
+	}
+
+	if (new_wd == -1) {
+		PFLOG(LOG_NOTICE, "inotify_add_watch: %m");
+	}
+	LOG(LOG_NOTICE, "Our inotify watch for '%s' went stale while we weren't looking", path);
+	// NOTE: The old one may still be around (e.g., if the file was moved), so, make sure it's gone.
+	inotify_rm_watch(inotify_fd, wd);
+	return new_wd;
+}
+
+// Recover from a queue overflow without tearing anything down
+// NOTE: We can't know which events we've missed, but we do know what we should be watching (i.e., watchConfig),
+//       so, make sure our existing watches are still sane, arm the ones that may now be armable,
+//       and ask the DB where each of our target files stands, c.f., queue_resync_checks.
+static void
+    resync_watches(void)
+{
+	if (fanotify_fd != -1) {
+		// NOTE: Our mark can't go stale, only our mountpoint watch could.
+		if (mountpoint_wd > 0) {
+			mountpoint_wd =
+			    revalidate_wd(mountpoint_wd, KFMON_TARGET_MOUNTPOINT, IN_DELETE_SELF | IN_ONLYDIR);
+		}
+	} else if (daemonConfig.watch_directories) {
+		for (uint16_t dir_idx = 0U; dir_idx < watchDirsCount; dir_idx++) {
+			if (watchDirs[dir_idx].wd > 0) {
+				watchDirs[dir_idx].wd = revalidate_wd(
+				    watchDirs[dir_idx].wd, watchDirs[dir_idx].path, IN_OPEN | IN_CLOSE | IN_ONLYDIR);
 			}
-			if (pthread_create(&rthread, &attr, reaper_thread, arg) != 0) {
-				PFLOG(LOG_ERR, "Aborting: pthread_create: %m");
-				fbink_print(FBFD_AUTO, "[KFMon] pthread_create failed ?!", &fbinkConfig);
-				exit(EXIT_FAILURE);
+		}
+	} else {
+		for (uint16_t watch_idx = 0U; watch_idx < watchListSize; watch_idx++) {
+			if (watchConfig[watch_idx].is_active && watchConfig[watch_idx].inotify_wd > 0) {
+				set_watch_wd(watch_idx,
+					     revalidate_wd(watchConfig[watch_idx].inotify_wd,
+							   watchConfig[watch_idx].filename,
+							   IN_OPEN | IN_CLOSE));
 			}
+		}
+	}
+	arm_watches();
 
-			// Prettify the thread's name. Must be <= 15 characters long (i.e., 16 bytes, NULL included).
-			char thname[16];
-			snprintf(thname, sizeof(thname), "Reap:%ld", (long) pid);
-			if (pthread_setname_np(rthread, thname) != 0) {
-				PFLOG(LOG_ERR, "Aborting: pthread_setname_np: %m");
-				fbink_print(FBFD_AUTO, "[KFMon] pthread_setname_np failed ?!", &fbinkConfig);
-				exit(EXIT_FAILURE);
-			}
+	resync_idx = 0;
+	queue_resync_checks();
+}
 
-			if (pthread_attr_destroy(&attr) != 0) {
-				PFLOG(LOG_ERR, "Aborting: pthread_attr_destroy: %m");
-				fbink_print(FBFD_AUTO, "[KFMon] pthread_attr_destroy failed ?!", &fbinkConfig);
-				exit(EXIT_FAILURE);
+// Queue resync DB checks while the DB worker has room for them (handle_db_results calls us again for the rest)
+// NOTE: We only ever take up to half of its queue, so we don't get in the way of actual events.
+static void
+    queue_resync_checks(void)
+{
+	while (resync_idx >= 0 && resync_idx < watchListSize) {
+		uint16_t watch_idx = (uint16_t) resync_idx;
+		if (watchConfig[watch_idx].is_active) {
+			pthread_mutex_lock(&DBW.lock);
+			bool is_full = DBW.in_flight >= DB_JOB_MAX / 2U;
+			pthread_mutex_unlock(&DBW.lock);
+			if (is_full) {
+				return;
 			}
+			// NOTE: That's an OPEN check, so it only ever updates the watch's state, c.f., handle_db_verdict.
+			queue_db_check(watch_idx, false);
 		}
+		resync_idx++;
 	}
 
-	return pid;
+	if (resync_idx >= 0) {
+		LOG(LOG_INFO, "Done resyncing our watches");
+		resync_idx = -1;
+	}
 }
 
-// Check if a given inotify watch already has a spawn running
-static bool
-    is_watch_already_spawned(uint8_t watch_idx)
+// Try to switch to a fanotify mark on the target mountpoint, instead of inotify watches
+// NOTE: That requires CAP_SYS_ADMIN, and a kernel built with CONFIG_FANOTIFY (2.6.37+),
+//       which rules out a few of the older Kobo kernels, so, we'll happily fall back to inotify.
+static void
+    init_fanotify(void)
 {
-	// Walk our process table to see if the given watch currently has a registered running process
-	for (uint8_t i = 0U; i < WATCH_MAX; i++) {
-		if (PT.spawn_watchids[i] == (int8_t) watch_idx) {
-			return true;
-			// NOTE: Assume everything's peachy,
-			//       and we'll never end up with the same watch_idx assigned to multiple indices in the
-			//       process table.
-		}
+	// NOTE: We want an fd for each event, as that's how we'll figure out which file it was about,
+	//       c.f., handle_fanotify_events.
+	// NOTE: We need CAP_SYS_ADMIN for fanotify anyway, so, we might as well get rid of the queue size limit.
+	fanotify_fd = fanotify_init(FAN_CLASS_NOTIF | FAN_UNLIMITED_QUEUE | FAN_NONBLOCK | FAN_CLOEXEC,
+				    O_RDONLY | O_LARGEFILE | O_CLOEXEC);
+	if (fanotify_fd == -1) {
+		PFLOG(LOG_WARNING, "fanotify_init: %m");
+		LOG(LOG_WARNING, "Cannot use fanotify, falling back to inotify watches!");
+		return;
 	}
 
-	return false;
+	add_event_source(fanotify_fd, EPOLLIN, handle_fanotify_events, 0U);
+	LOG(LOG_INFO, "Using fanotify to monitor %s", KFMON_TARGET_MOUNTPOINT);
 }
 
-// Check if a watch flagged as a spawn blocker (e.g., KOReader or Plato) is already running
-// NOTE: This is mainly to prevent spurious spawns that might be unwittingly caused by their file manager
-//       (be it through metadata reading, thumbnails creation, or whatever).
-//       Another workaround is of course to kill KFMon as part of their startup process...
+// Mark the target mountpoint for fanotify 'file was opened' and 'file was closed' events, if that's not done already
+// NOTE: Returns false if that failed, in which case we've given up on fanotify,
+//       and the caller should setup inotify watches instead.
 static bool
-    is_blocker_running(void)
+    arm_fanotify(void)
 {
-	// Walk our process table to identify watches with a currently running process
-	for (uint8_t i = 0U; i < WATCH_MAX; i++) {
-		if (PT.spawn_watchids[i] != -1) {
-			// Walk the active watch list to match that currently running watch to its block_spawns flag
-			for (uint8_t watch_idx = 0U; watch_idx < WATCH_MAX; watch_idx++) {
-				if (!watchConfig[watch_idx].is_active) {
-					continue;
-				}
+	// NOTE: As long as our watch on the mountpoint is alive, so is the mount, and so is our mark on it.
+	if (mountpoint_wd > 0) {
+		return true;
+	}
 
-				if (PT.spawn_watchids[i] == (int8_t) watch_idx) {
-					if (watchConfig[watch_idx].block_spawns) {
-						return true;
-					}
-				}
-			}
-		}
+	// NOTE: We don't care about the mountpoint's own events, we'll get IN_UNMOUNT & IN_IGNORED regardless.
+	mountpoint_wd = inotify_add_watch(inotify_fd, KFMON_TARGET_MOUNTPOINT, IN_DELETE_SELF | IN_ONLYDIR);
+	if (mountpoint_wd == -1) {
+		PFLOG(LOG_WARNING, "inotify_add_watch: %m");
+	} else if (fanotify_mark(fanotify_fd,
+				 FAN_MARK_ADD | FAN_MARK_MOUNT,
+				 FAN_OPEN | FAN_CLOSE,
+				 AT_FDCWD,
+				 KFMON_TARGET_MOUNTPOINT) == 0) {
+		LOG(LOG_NOTICE, "Setup a fanotify mark for the %s mount.", KFMON_TARGET_MOUNTPOINT);
+		return true;
+	} else {
+		PFLOG(LOG_WARNING, "fanotify_mark: %m");
+		inotify_rm_watch(inotify_fd, mountpoint_wd);
+		mountpoint_wd = -1;
 	}
 
-	// Nothing currently running is a spawn blocker, we're good to go!
+	// We can't keep track of unmounts, or we weren't allowed to setup the mark: either way, give up on fanotify.
+	LOG(LOG_WARNING, "Cannot use fanotify on %s, falling back to inotify watches!", KFMON_TARGET_MOUNTPOINT);
+	remove_event_source(fanotify_fd);
+	close(fanotify_fd);
+	fanotify_fd = -1;
 	return false;
 }
 
-// Check if spawns are inhibited by the global block file
-static bool
-    are_spawns_blocked(void)
+// Record an event on a watch's target file in the current batch (only IN_OPEN & IN_CLOSE are honored)
+static void
+    queue_watch_event(uint16_t watch_idx, uint32_t mask)
 {
-	const char block_path[] = KFMON_CONFIGPATH "/BLOCK";
-	if (access(block_path, F_OK) == 0) {
-		// Global block file is here, prevent new spawns...
-		return true;
+	mask &= IN_OPEN | IN_CLOSE;
+	if (!mask) {
+		return;
 	}
 
-	return false;
+	EventSummary* summary = &watchConfig[watch_idx].batch;
+	if (summary->count == 0U) {
+		// First time we're seeing that one in this batch, append it to the list
+		summary->mask = 0U;
+		summary->next = -1;
+		if (EventBatch.tail == -1) {
+			EventBatch.head = watch_idx;
+		} else {
+			watchConfig[EventBatch.tail].batch.next = watch_idx;
+		}
+		EventBatch.tail = watch_idx;
+	}
+	summary->mask |= mask;
+	// NOTE: fanotify may merge an open & a close in a single event, in which case the close necessarily came last.
+	summary->last = (mask & IN_CLOSE) ? (uint32_t) IN_CLOSE : (uint32_t) IN_OPEN;
+	uint16_t count = (uint16_t) (((mask & IN_OPEN) ? 1U : 0U) + ((mask & IN_CLOSE) ? 1U : 0U));
+	if (summary->count <= UINT16_MAX - count) {
+		summary->count = (uint16_t) (summary->count + count);
+	}
+	EventBatch.events += count;
 }
 
-// Return the pid of the spawn of a given inotify watch
-static pid_t
-    get_spawn_pid_for_watch(uint8_t watch_idx)
+// Make a single decision per watch for the batch of events we've just read
+// NOTE: Nickel tends to open & close an icon a few times in a row (e.g., when it generates its thumbnails),
+//       and each of those used to cost us a DB check (and the blocker checks).
+//       Instead, we only act on one of each kind, in an order that honors the last event we saw:
+//       a trailing CLOSE is handled after its OPEN, and a trailing OPEN will get its CLOSE in a later batch.
+static void
+    flush_watch_events(void)
 {
-	for (uint8_t i = 0U; i < WATCH_MAX; i++) {
-		if (PT.spawn_watchids[i] == (int8_t) watch_idx) {
-			return PT.spawn_pids[i];
+	while (EventBatch.head != -1) {
+		uint16_t           watch_idx = (uint16_t) EventBatch.head;
+		const EventSummary summary   = watchConfig[watch_idx].batch;
+		EventBatch.head              = summary.next;
+		watchConfig[watch_idx].batch = (const EventSummary){ 0 };
+
+		uint16_t decisions =
+		    (uint16_t) (((summary.mask & IN_OPEN) ? 1U : 0U) + ((summary.mask & IN_CLOSE) ? 1U : 0U));
+		if (summary.count > decisions) {
+			EventBatch.coalesced += summary.count - decisions;
+			LOG(LOG_INFO,
+			    "Coalesced %hu events into %hu for %s",
+			    summary.count,
+			    decisions,
+			    watchConfig[watch_idx].filename);
+		}
+
+		if (summary.last == IN_CLOSE) {
+			handle_watch_event(watch_idx, summary.mask & IN_OPEN);
+			handle_watch_event(watch_idx, IN_CLOSE);
+		} else {
+			handle_watch_event(watch_idx, summary.mask & IN_CLOSE);
+			handle_watch_event(watch_idx, IN_OPEN);
 		}
 	}
+	EventBatch.tail = -1;
 
-	return -1;
+	DBGLOG("Coalesced %llu out of %llu events so far",
+	       (unsigned long long) EventBatch.coalesced,
+	       (unsigned long long) EventBatch.events);
+}
+
+// React to a file being opened and/or closed (only IN_OPEN & IN_CLOSE are honored) on the given watch's target file
+static void
+    handle_watch_event(uint16_t watch_idx, uint32_t mask)
+{
+	if (mask & IN_OPEN) {
+		LOG(LOG_NOTICE, "Tripped IN_OPEN for %s", watchConfig[watch_idx].filename);
+		// Clunky detection of potential Nickel processing...
+		bool is_watch_spawned   = is_watch_already_spawned(watch_idx);
+		bool is_blocker_spawned = is_blocker_running();
+		bool is_spawn_blocked   = are_spawns_blocked();
+
+		if (!is_watch_spawned && !is_blocker_spawned && !is_spawn_blocked) {
+			// Only check if we're ready to spawn something...
+			// NOTE: The DB lookup happens in the DB worker thread, c.f., handle_db_verdict.
+			queue_db_check(watch_idx, false);
+		}
+	}
+	if (mask & IN_CLOSE) {
+		LOG(LOG_NOTICE, "Tripped IN_CLOSE for %s", watchConfig[watch_idx].filename);
+		// NOTE: Make sure we won't run a specific command multiple times
+		//       while an earlier instance of it is still running...
+		//       This is mostly of interest for KOReader/Plato:
+		//       it means we can keep KFMon running while they're up,
+		//       without risking trying to spawn multiple instances of them,
+		//       in case they end up tripping their own inotify watch ;).
+		bool is_watch_spawned   = is_watch_already_spawned(watch_idx);
+		bool is_blocker_spawned = is_blocker_running();
+		bool is_spawn_blocked   = are_spawns_blocked();
+
+		if (!is_watch_spawned && !is_blocker_spawned && !is_spawn_blocked) {
+			// Check that our target file has already fully been processed by Nickel
+			// before launching anything...
+			// NOTE: The DB worker thread does that, the spawn happens in handle_db_verdict.
+			if (!queue_db_check(watch_idx, true)) {
+				LOG(LOG_NOTICE,
+				    "Couldn't check whether target icon '%s' was processed, don't launch anything.",
+				    watchConfig[watch_idx].filename);
+			}
+		} else {
+			if (is_watch_spawned) {
+				pid_t spid = get_spawn_pid_for_watch(watch_idx);
+
+				LOG(LOG_INFO,
+				    "As watch idx %hu (%s) still has a spawned process (%ld -> %s) running, we won't be spawning another instance of it!",
+				    watch_idx,
+				    watchConfig[watch_idx].filename,
+				    (long) spid,
+				    watchConfig[watch_idx].action);
+				fbink_printf(FBFD_AUTO,
+					     NULL,
+					     &fbinkConfig,
+					     "[KFMon] Not spawning %s: still running!",
+					     basename(watchConfig[watch_idx].action));
+			} else if (is_blocker_spawned) {
+				LOG(LOG_INFO,
+				    "As a spawn blocker process is currently running, we won't be spawning anything else to prevent unwanted behavior!");
+				fbink_printf(FBFD_AUTO,
+					     NULL,
+					     &fbinkConfig,
+					     "[KFMon] Not spawning %s: blocked!",
+					     basename(watchConfig[watch_idx].action));
+			} else if (is_spawn_blocked) {
+				LOG(LOG_INFO, "As the global spawn inhibiter flag is present, we won't be spawning anything!");
+				fbink_printf(FBFD_AUTO,
+					     NULL,
+					     &fbinkConfig,
+					     "[KFMon] Not spawning %s: inhibited!",
+					     basename(watchConfig[watch_idx].action));
+			}
+		}
+	}
 }
 
-// Read all available inotify events from the file descriptor 'fd' (caller breaks on true).
+// Read all available inotify events from the file descriptor 'fd' (stops the event loop on true).
 static bool
-    handle_events(int fd)
+    handle_events(int fd, uint32_t events __attribute__((unused)), uint32_t data __attribute__((unused)))
 {
 	// NOTE: Because the framebuffer state is liable to have changed since our last init/reinit,
 	//       either expectedly (boot -> pickel -> nickel), or a bit more unpredictably (rotation, bitdepth change),
 	//       we'll ask FBInk to make sure it has an up-to-date fb state for each new batch of events,
 	//       so that messages will be printed properly, no matter what :).
-	//       Put everything behind our mutex to be super-safe,
-	//       since we're playing with library globals...
+	//       No need for locking, even though we're playing with library globals,
+	//       as the main thread is the only one that ever prints anything.
 	// NOTE: Even forgetting about rotation and bitdepth changes, which may not ever happen on most *vanilla* devices,
 	//       this is needed because processing is done very early by Nickel for "new" icons,
 	//       when they end up on the Home screen straight away,
 	//       (which is a given if you added at most 3 items, with the new Home screen).
 	//       Not doing a reinit would be problematic, because it's early enough that pickel is still running,
 	//       so we'd be inheriting its quirky fb setup and not Nickel's...
-	// NOTE: This was moved from inside the following loop to here, just outside of it, in order to limit locking,
+	// NOTE: This was moved from inside the following loop to here, just outside of it, in order to limit overhead,
 	//       but it will in fact change nothing if events aren't actually batched,
 	//       which appears to be the case in most of our use-cases...
-	pthread_mutex_lock(&ptlock);
 	// NOTE: It went fine once, assume that'll still be the case and skip error checking...
 	fbink_reinit(FBFD_AUTO, &fbinkConfig);
-	pthread_mutex_unlock(&ptlock);
 
 	// Some systems cannot read integer variables if they are not properly aligned.
 	// On other systems, incorrect alignment may decrease performance.
@@ -1970,6 +5338,7 @@ static bool
 	const struct inotify_event* event;
 	bool                        destroyed_wd  = false;
 	bool                        was_unmounted = false;
+	bool                        needs_resync  = false;
 
 	// Loop while events can be read from inotify file descriptor.
 	for (;;) {
@@ -1999,173 +5368,79 @@ static bool
 			event = (const struct inotify_event*) ptr;
 #pragma GCC diagnostic pop
 
+			// NOTE: A queue overflow isn't tied to any wd (it's flagged with a wd of -1),
+			//       so, deal with it before we try to look one up,
+			//       as that could otherwise match something that isn't currently armed.
+			//       We cannot know what we missed, so, resync everything at the end of this batch.
+			if (event->mask & IN_Q_OVERFLOW) {
+				LOG(LOG_WARNING, "Huh oh... Tripped IN_Q_OVERFLOW, resyncing all our watches!");
+				needs_resync = true;
+				continue;
+			}
+
 			// Identify which of our target file we've caught an event for...
-			uint8_t watch_idx       = 0U;
-			bool    found_watch_idx = false;
-			for (watch_idx = 0U; watch_idx < WATCH_MAX; watch_idx++) {
-				// Needs to be an active watch
-				if (!watchConfig[watch_idx].is_active) {
+			int32_t match = -1;
+			if (fanotify_fd != -1) {
+				// NOTE: With fanotify, all we're watching here is the mountpoint (c.f., arm_fanotify),
+				//       and we only care about it going away.
+				if (mountpoint_wd > 0 && event->wd == mountpoint_wd) {
+					if (event->mask & IN_UNMOUNT) {
+						LOG(LOG_NOTICE, "Tripped IN_UNMOUNT for %s", KFMON_TARGET_MOUNTPOINT);
+						was_unmounted = true;
+					}
+					if (event->mask & IN_IGNORED) {
+						LOG(LOG_NOTICE, "Tripped IN_IGNORED for %s", KFMON_TARGET_MOUNTPOINT);
+						mountpoint_wd = -1;
+						destroyed_wd  = true;
+					}
 					continue;
 				}
-
-				if (watchConfig[watch_idx].inotify_wd == event->wd) {
-					found_watch_idx = true;
-					break;
+			} else if (daemonConfig.watch_directories) {
+				int32_t dir_idx = find_watch_dir_by_wd(event->wd);
+				if (dir_idx >= 0 && event->len == 0U) {
+					// NOTE: That one is about the directory itself, we only care if it is gone
+					//       (it's opened & closed whenever something lists it, which we ignore).
+					if (event->mask & IN_UNMOUNT) {
+						LOG(LOG_NOTICE, "Tripped IN_UNMOUNT for %s", watchDirs[dir_idx].path);
+						was_unmounted = true;
+					}
+					if (event->mask & IN_IGNORED) {
+						LOG(LOG_NOTICE, "Tripped IN_IGNORED for %s", watchDirs[dir_idx].path);
+						watchDirs[dir_idx].wd = -1;
+						destroyed_wd          = true;
+					}
+					continue;
 				}
-			}
-			if (!found_watch_idx) {
-				// NOTE: Err, that should (hopefully) never happen!
-				LOG(LOG_CRIT,
-				    "!! Failed to match the current inotify event to any of our watched file! !!");
-				// NOTE: First, point to the final slot, instead of OOB. This'll at least avoid UB.
-				//       We *probably* ought to fail harder here, though,
-				//       but I *do* want to drain the event...
-				watch_idx = WATCH_MAX - 1;
-			}
-
-			// Print event type
-			if (event->mask & IN_OPEN) {
-				LOG(LOG_NOTICE, "Tripped IN_OPEN for %s", watchConfig[watch_idx].filename);
-				// Clunky detection of potential Nickel processing...
-				bool is_watch_spawned;
-				bool is_blocker_spawned;
-				pthread_mutex_lock(&ptlock);
-				is_watch_spawned   = is_watch_already_spawned(watch_idx);
-				is_blocker_spawned = is_blocker_running();
-				pthread_mutex_unlock(&ptlock);
-				bool is_spawn_blocked = are_spawns_blocked();
-
-				if (!is_watch_spawned && !is_blocker_spawned && !is_spawn_blocked) {
-					// Only check if we're ready to spawn something...
-					if (!is_target_processed(watch_idx, false)) {
-						// It's not processed on OPEN, flag as pending...
-						watchConfig[watch_idx].pending_processing = true;
-						LOG(LOG_INFO,
-						    "Flagged target icon '%s' as pending processing ...",
-						    watchConfig[watch_idx].filename);
-					} else {
-						// It's already processed, we're good!
-						watchConfig[watch_idx].pending_processing = false;
+				if (dir_idx >= 0) {
+					// NOTE: We get events for *every* file in there, most of which aren't ours,
+					//       so, skip those silently.
+					match = find_watch_by_basename(event->name);
+					if (match < 0 || !is_watch_in_dir((uint16_t) match, (uint16_t) dir_idx)) {
+						continue;
 					}
 				}
+			} else {
+				match = find_watch_by_wd(event->wd);
 			}
-			if (event->mask & IN_CLOSE) {
-				LOG(LOG_NOTICE, "Tripped IN_CLOSE for %s", watchConfig[watch_idx].filename);
-				// NOTE: Make sure we won't run a specific command multiple times
-				//       while an earlier instance of it is still running...
-				//       This is mostly of interest for KOReader/Plato:
-				//       it means we can keep KFMon running while they're up,
-				//       without risking trying to spawn multiple instances of them,
-				//       in case they end up tripping their own inotify watch ;).
-				bool is_watch_spawned;
-				bool is_blocker_spawned;
-				pthread_mutex_lock(&ptlock);
-				is_watch_spawned   = is_watch_already_spawned(watch_idx);
-				is_blocker_spawned = is_blocker_running();
-				pthread_mutex_unlock(&ptlock);
-				bool is_spawn_blocked = are_spawns_blocked();
-
-				if (!is_watch_spawned && !is_blocker_spawned && !is_spawn_blocked) {
-					// Check that our target file has already fully been processed by Nickel
-					// before launching anything...
-					bool should_spawn = !watchConfig[watch_idx].pending_processing &&
-							    is_target_processed(watch_idx, true);
-					// NOTE: In case the target file has been processed during this power cycle,
-					//       check that it happened at least 10s ago, to avoid spurious launches on start,
-					//       as FW 4.13 now appears to trigger an extra set of open/close events on startup,
-					//       right *after* having processed a new image. Which means that without this check,
-					//       it happily blazes right through every other checks,
-					//       and ends up running the new target script straightaway... :/
-					if (should_spawn && watchConfig[watch_idx].processing_ts > 0) {
-						struct timespec now = { 0 };
-						clock_gettime(CLOCK_MONOTONIC_RAW, &now);
-						if (now.tv_sec - watchConfig[watch_idx].processing_ts <= 10) {
-							LOG(LOG_NOTICE,
-							    "Target icon '%s' has only *just* finished processing, assuming this is a spurious post-processing event!",
-							    watchConfig[watch_idx].filename);
-							should_spawn = false;
-						} else {
-							// Now that everything appears sane, clear the processing timestamp,
-							// to avoid going through this branch for the rest of this power cycle ;).
-							LOG(LOG_NOTICE,
-							    "Target icon '%s' should be properly processed by now :)",
-							    watchConfig[watch_idx].filename);
-							watchConfig[watch_idx].processing_ts = 0;
-						}
-					}
-
-					if (should_spawn) {
-						LOG(LOG_INFO,
-						    "Preparing to spawn %s for watch idx %hhu . . .",
-						    watchConfig[watch_idx].action,
-						    watch_idx);
-						if (watchConfig[watch_idx].block_spawns) {
-							LOG(LOG_NOTICE,
-							    "%s is flagged as a spawn blocker, it will prevent *any* event from triggering a spawn while it is still running!",
-							    watchConfig[watch_idx].action);
-						}
-						// We're using execvp()...
-						char* const cmd[] = { watchConfig[watch_idx].action, NULL };
-						spawn(cmd, watch_idx);
-					} else {
-						LOG(LOG_NOTICE,
-						    "Target icon '%s' might not have been fully processed by Nickel yet, don't launch anything.",
-						    watchConfig[watch_idx].filename);
-						fbink_printf(FBFD_AUTO,
-							     NULL,
-							     &fbinkConfig,
-							     "[KFMon] Not spawning %s: still processing!",
-							     basename(watchConfig[watch_idx].action));
-						// NOTE: That, or we hit a SQLITE_BUSY timeout on OPEN,
-						//       which tripped our 'pending processing' check.
-						// NOTE: The first time we encounter a not-yet processed file on close,
-						//       remember it, so we can avoid a spurious launch in case Nickel
-						//       triggers multiple open/close events in a very short amount of time,
-						//       as seems to be the case on startup since FW 4.13 for brand new files...
-						if (watchConfig[watch_idx].processing_ts == 0) {
-							struct timespec now;
-							if (clock_gettime(CLOCK_MONOTONIC_RAW, &now) == 0) {
-								watchConfig[watch_idx].processing_ts = now.tv_sec;
-							}
-						}
-					}
-				} else {
-					if (is_watch_spawned) {
-						pid_t spid;
-						pthread_mutex_lock(&ptlock);
-						spid = get_spawn_pid_for_watch(watch_idx);
-						pthread_mutex_unlock(&ptlock);
-
-						LOG(LOG_INFO,
-						    "As watch idx %hhu (%s) still has a spawned process (%ld -> %s) running, we won't be spawning another instance of it!",
-						    watch_idx,
-						    watchConfig[watch_idx].filename,
-						    (long) spid,
-						    watchConfig[watch_idx].action);
-						fbink_printf(FBFD_AUTO,
-							     NULL,
-							     &fbinkConfig,
-							     "[KFMon] Not spawning %s: still running!",
-							     basename(watchConfig[watch_idx].action));
-					} else if (is_blocker_spawned) {
-						LOG(LOG_INFO,
-						    "As a spawn blocker process is currently running, we won't be spawning anything else to prevent unwanted behavior!");
-						fbink_printf(FBFD_AUTO,
-							     NULL,
-							     &fbinkConfig,
-							     "[KFMon] Not spawning %s: blocked!",
-							     basename(watchConfig[watch_idx].action));
-					} else if (is_spawn_blocked) {
-						LOG(LOG_INFO,
-						    "As the global spawn inhibiter flag is present, we won't be spawning anything!");
-						fbink_printf(FBFD_AUTO,
-							     NULL,
-							     &fbinkConfig,
-							     "[KFMon] Not spawning %s: inhibited!",
-							     basename(watchConfig[watch_idx].action));
-					}
+			uint16_t watch_idx = (uint16_t) match;
+			if (match < 0) {
+				// NOTE: That's the kernel acknowledging a watch we removed (c.f., disarm_watch),
+				//       or a straggler from an unmount, for a watch we already know is gone.
+				if (event->mask & (IN_IGNORED | IN_UNMOUNT)) {
+					DBGLOG("Dropped event %#x for stale wd %d", event->mask, event->wd);
+					continue;
 				}
+				// NOTE: Err, that should (hopefully) never happen (barring stragglers for a removed wd)!
+				//       Since there's no slot to point to, just drain the event.
+				LOG(LOG_CRIT,
+				    "!! Failed to match the current inotify event (wd: %d, mask: %#x) to any of our watched file! !!",
+				    event->wd,
+				    event->mask);
+				continue;
 			}
+
+			// NOTE: We only act on those once we've gone through the whole batch, c.f., flush_watch_events.
+			queue_watch_event(watch_idx, event->mask);
 			if (event->mask & IN_UNMOUNT) {
 				LOG(LOG_NOTICE, "Tripped IN_UNMOUNT for %s", watchConfig[watch_idx].filename);
 				// Remember that we encountered an unmount,
@@ -2177,127 +5452,193 @@ static bool
 			//       we actually never get an IN_UNMOUNT event, only IN_IGNORED...
 			//       Another strange behavior is that we get them in a staggered mannered,
 			//       and not in one batch, as I do on my sandbox when unmounting a tmpfs...
-			//       That may explain why the explicit inotify_rm_watch() calls we do later
-			//       on all our other watches don't seem to error out...
 			//       In the end, we behave properly, but it's still strange enough to document ;).
+			// NOTE: Only that watch is gone, the others are left alone: it'll be re-armed on its own
+			//       when we go back to the main loop (c.f., arm_watches).
+			//       And if it was because of an unmount, the others will follow suit soon enough.
 			if (event->mask & IN_IGNORED) {
 				LOG(LOG_NOTICE, "Tripped IN_IGNORED for %s", watchConfig[watch_idx].filename);
-				// Remember that the watch was automatically destroyed so we can break from the loop...
-				destroyed_wd                            = true;
-				watchConfig[watch_idx].wd_was_destroyed = true;
-			}
-			if (event->mask & IN_Q_OVERFLOW) {
-				if (event->len) {
-					LOG(LOG_WARNING, "Huh oh... Tripped IN_Q_OVERFLOW for %s", event->name);
-				} else {
-					LOG(LOG_WARNING, "Huh oh... Tripped IN_Q_OVERFLOW for... something?");
-				}
-				// Try to remove the inotify watch we matched
-				// (... hoping matching actually was successful), and break the loop.
-				LOG(LOG_INFO,
-				    "Trying to remove inotify watch for '%s' @ index %hhu.",
-				    watchConfig[watch_idx].filename,
-				    watch_idx);
-				if (inotify_rm_watch(fd, watchConfig[watch_idx].inotify_wd) == -1) {
-					// That's too bad, but may not be fatal, so warn only...
-					PFLOG(LOG_WARNING, "inotify_rm_watch: %m");
-				} else {
-					// Flag it as gone if rm was successful
-					watchConfig[watch_idx].inotify_wd = -1;
-				}
-				destroyed_wd                            = true;
-				watchConfig[watch_idx].wd_was_destroyed = true;
+				// Forget about that wd, and remember it was destroyed so we can break from the loop...
+				set_watch_wd(watch_idx, -1);
+				destroyed_wd = true;
 			}
 		}
 
+		// Now that we've gone through the whole batch, act on it
+		flush_watch_events();
+		if (needs_resync && !was_unmounted) {
+			resync_watches();
+		}
+		needs_resync = false;
+
 		// If we caught an unmount, explain why we don't explicitly have to tear down our watches
 		if (was_unmounted) {
 			LOG(LOG_INFO, "Unmount detected, nothing to do, all watches will naturally get destroyed.");
+			// NOTE: Since by design, all our target files live on the same mountpoint,
+			//       we can forget about all of them right now, instead of waiting for their IN_IGNORED
+			//       (which, as mentioned above, may trickle in over a few batches).
+			forget_all_watches();
+			enter_exported_state();
+			destroyed_wd = true;
 		}
 		// If we caught an event indicating that a watch was automatically destroyed, break the loop.
 		if (destroyed_wd) {
-			// But before we do that, make sure we've removed *all* our *other* active watches first
-			// (again, hoping matching was successful), since we'll be setting them up all again later...
-			for (uint8_t watch_idx = 0U; watch_idx < WATCH_MAX; watch_idx++) {
-				if (!watchConfig[watch_idx].is_active) {
-					continue;
-				}
+			break;
+		}
+	}
 
-				if (!watchConfig[watch_idx].wd_was_destroyed) {
-					// Don't do anything if that was because of an unmount...
-					// Because that assures us that everything is/will soon be gone
-					// (since by design, all our target files live on the same mountpoint),
-					// even if we didn't get to parse all the events in one go
-					// to flag them as destroyed one by one.
-					if (!was_unmounted) {
-						// Check if that watch index is active to begin with,
-						// as we might have just skipped it if its target file was missing...
-						if (watchConfig[watch_idx].inotify_wd == -1) {
-							LOG(LOG_INFO,
-							    "Inotify watch for '%s' @ index %hhu is already inactive!",
-							    watchConfig[watch_idx].filename,
-							    watch_idx);
-						} else {
-							// Log what we're doing...
-							LOG(LOG_INFO,
-							    "Trying to remove inotify watch for '%s' @ index %hhu.",
-							    watchConfig[watch_idx].filename,
-							    watch_idx);
-							if (inotify_rm_watch(fd, watchConfig[watch_idx].inotify_wd) ==
-							    -1) {
-								// That's too bad, but may not be fatal, so warn only...
-								PFLOG(LOG_WARNING, "inotify_rm_watch: %m");
-							} else {
-								// It's gone!
-								watchConfig[watch_idx].inotify_wd = -1;
-							}
-						}
-					}
-				} else {
-					// Reset the flag to avoid false-positives on the next iteration of the loop,
-					// since we re-use the array's content.
-					watchConfig[watch_idx].wd_was_destroyed = false;
-				}
+	// And we have another outer loop to break, so pass that on...
+	return destroyed_wd;
+}
+
+// Is that process one of our spawns, or one of their descendants?
+// NOTE: We walk up the process tree via procfs, which is a bit expensive, so only do that for events on our target files.
+static bool
+    is_spawned_process(pid_t pid)
+{
+	while (pid > 1) {
+		for (uint16_t i = 0U; i < PT.size; i++) {
+			if (PT.spawn_pids[i] == pid) {
+				return true;
+			}
+		}
+
+		// Move on to its parent...
+		char procfile[PATH_MAX];
+		snprintf(procfile, sizeof(procfile), "/proc/%ld/stat", (long) pid);
+		FILE* f = fopen(procfile, "re");
+		if (!f) {
+			// It's already gone, so there's no telling, assume it wasn't ours.
+			return false;
+		}
+		char   stat[512];
+		size_t size = fread(stat, sizeof(*stat), sizeof(stat) - 1U, f);
+		fclose(f);
+		stat[size] = '\0';
+		// NOTE: The command name may contain spaces and parentheses, so, look for the *last* closing one.
+		const char* comm_end = strrchr(stat, ')');
+		long        ppid;
+		if (!comm_end || sscanf(comm_end, ") %*c %ld", &ppid) != 1) {
+			return false;
+		}
+		pid = (pid_t) ppid;
+	}
+
+	return false;
+}
+
+// Read all available fanotify events from the file descriptor 'fd', and dispatch those on our target files
+// NOTE: Unlike inotify, our mark survives anything short of an unmount, which handle_events takes care of,
+//       so, this never stops the event loop.
+static bool
+    handle_fanotify_events(int fd, uint32_t events __attribute__((unused)), uint32_t data __attribute__((unused)))
+{
+	// NOTE: Same deal as in handle_events.
+	fbink_reinit(FBFD_AUTO, &fbinkConfig);
+
+	char        buf[4096] __attribute__((aligned(__alignof__(struct fanotify_event_metadata))));
+	const pid_t self = getpid();
+
+	// Loop while events can be read from the fanotify file descriptor.
+	for (;;) {
+		ssize_t len = read(fd, buf, sizeof(buf));    // Flawfinder: ignore
+		if (len == -1 && errno != EAGAIN) {
+			if (errno == EINTR) {
+				continue;
+			}
+			PFLOG(LOG_ERR, "Aborting: read: %m");
+			fbink_print(FBFD_AUTO, "[KFMon] read failed ?!", &fbinkConfig);
+			exit(EXIT_FAILURE);
+		}
+
+		if (len <= 0) {
+			break;
+		}
+
+		// NOTE: This trips -Wcast-align on ARM, but should be safe nonetheless ;).
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wcast-align"
+		struct fanotify_event_metadata* event = (struct fanotify_event_metadata*) buf;
+		for (; FAN_EVENT_OK(event, len); event = FAN_EVENT_NEXT(event, len)) {
+#pragma GCC diagnostic pop
+			if (event->vers != FANOTIFY_METADATA_VERSION) {
+				LOG(LOG_ERR, "Aborting: fanotify ABI mismatch (%hhu vs. %d)!", event->vers, FANOTIFY_METADATA_VERSION);
+				fbink_print(FBFD_AUTO, "[KFMon] fanotify ABI mismatch ?!", &fbinkConfig);
+				exit(EXIT_FAILURE);
+			}
+			// NOTE: There's nothing to re-arm here, we just lost a few events, and there's no telling which.
+			if (event->mask & FAN_Q_OVERFLOW) {
+				LOG(LOG_WARNING, "Huh oh... Tripped FAN_Q_OVERFLOW, some events were lost!");
+				continue;
+			}
+			if (event->fd == FAN_NOFD) {
+				continue;
+			}
+
+			// NOTE: We're marking a whole mount, so, most of these won't be about our target files.
+			//       Figure out which file it was via procfs, so we can check it against our filename index.
+			char fd_path[PATH_MAX];
+			char path[PATH_MAX];
+			snprintf(fd_path, sizeof(fd_path), "/proc/self/fd/%d", event->fd);
+			ssize_t path_len = readlink(fd_path, path, sizeof(path) - 1U);
+			close(event->fd);
+			if (path_len == -1) {
+				PFLOG(LOG_WARNING, "readlink: %m");
+				continue;
+			}
+			path[path_len] = '\0';
+
+			int32_t match = find_watch_by_filename(path);
+			if (match < 0) {
+				continue;
+			}
+
+			// NOTE: Unlike inotify, fanotify tells us *who* opened the file,
+			//       so we can simply ignore our own (and our spawns') accesses,
+			//       instead of relying on block_spawns.
+			if (event->pid == self || is_spawned_process(event->pid)) {
+				DBGLOG("Ignored event %#llx on %s from our own process %ld",
+				       (unsigned long long) event->mask,
+				       path,
+				       (long) event->pid);
+				continue;
 			}
-			break;
+
+			// NOTE: The fanotify flags we care about share the values of their inotify counterparts,
+			//       but let's not rely on that.
+			uint32_t mask = 0U;
+			if (event->mask & FAN_OPEN) {
+				mask |= IN_OPEN;
+			}
+			if (event->mask & FAN_CLOSE) {
+				mask |= IN_CLOSE;
+			}
+			queue_watch_event((uint16_t) match, mask);
 		}
+
+		// Now that we've gone through the whole batch, act on it
+		flush_watch_events();
 	}
 
-	// And we have another outer loop to break, so pass that on...
-	return destroyed_wd;
+	return false;
 }
 
-// Handle input data from a successful IPC connection (caller breaks on true).
+// Handle a single command from an IPC client, and queue our reply (caller closes the connection on false).
 static bool
-    handle_ipc(int data_fd)
+    handle_ipc(IpcClient* client, const char* req, size_t len)
 {
 	// Eh, recycle PIPE_BUF, it should be more than enough for our needs.
 	char buf[PIPE_BUF] = { 0 };
 
-	// We don't actually know the size of the input data, so, best effort here.
-	ssize_t len = xread(data_fd, buf, sizeof(buf) - 1U);
-	if (len < 0) {
-		// Only actual failures are left, xread handles the rest
-		PFLOG(LOG_WARNING, "read: %m");
-		fbink_print(FBFD_AUTO, "[KFMon] read failed ?!", &fbinkConfig);
-		// Signal our polling to close the connection, don't retry, as we risk failing here again otherwise.
-		return true;
-	}
-
-	if (len == 0) {
-		// EoF, we're done, signal our polling to close the connection
-		return true;
-	}
-
 	// Handle the supported commands
-	if ((strncasecmp(buf, "list", 4) == 0) || (strncasecmp(buf, "gui-list", 8) == 0)) {
+	if ((strncasecmp(req, "list", 4) == 0) || (strncasecmp(req, "gui-list", 8) == 0)) {
 		LOG(LOG_INFO, "Processing IPC watch listing request");
 		// Discriminate gui-list
-		bool gui = (buf[0] == 'g' || buf[0] == 'G');
+		bool gui = (req[0] == 'g' || req[0] == 'G');
 
 		// Reply with a list of active watches, format is id:basename(filename):label (separated by a LF)
 		//                                             or id:basename(filename) if the watch has no label set.
-		for (uint8_t watch_idx = 0U; watch_idx < WATCH_MAX; watch_idx++) {
+		for (uint16_t watch_idx = 0U; watch_idx < watchListSize; watch_idx++) {
 			if (!watchConfig[watch_idx].is_active) {
 				continue;
 			}
@@ -2312,97 +5653,67 @@ static bool
 			if (*watchConfig[watch_idx].label) {
 				packet_len = snprintf(buf,
 						      sizeof(buf),
-						      "%hhu:%s:%s\n",
+						      "%hu:%s:%s\n",
 						      watch_idx,
 						      basename(watchConfig[watch_idx].filename),
 						      watchConfig[watch_idx].label);
 			} else {
 				packet_len = snprintf(
-				    buf, sizeof(buf), "%hhu:%s\n", watch_idx, basename(watchConfig[watch_idx].filename));
+				    buf, sizeof(buf), "%hu:%s\n", watch_idx, basename(watchConfig[watch_idx].filename));
 			}
 			// Make sure we reply with that in full (w/o a NUL, we're not done yet) to the client.
-			if (send_in_full(data_fd, buf, (size_t)(packet_len)) < 0) {
-				// Only actual failures are left, so we're pretty much done
-				if (errno == EPIPE) {
-					PFLOG(LOG_WARNING, "Client closed the connection early");
-				} else {
-					PFLOG(LOG_WARNING, "send: %m");
-					fbink_print(FBFD_AUTO, "[KFMon] send failed ?!", &fbinkConfig);
-				}
-				// Don't retry on write failures, just signal our polling to close the connection
-				return true;
+			if (!queue_ipc_reply(client, buf, (size_t) packet_len)) {
+				return false;
 			}
-			// NOTE: In debug mode, add a delay to test handling of replies split across multiple reads in clients...
-#ifdef DEBUG
-			const struct timespec zzz = { 0L, 250000000L };
-			nanosleep(&zzz, NULL);
-#endif
 		}
 		// Now that we're done, send a final NUL, just to be nice.
 		buf[0] = '\0';
-		if (send_in_full(data_fd, buf, 1U) < 0) {
-			// Only actual failures are left, so we're pretty much done
-			if (errno == EPIPE) {
-				PFLOG(LOG_WARNING, "Client closed the connection early");
-			} else {
-				PFLOG(LOG_WARNING, "send: %m");
-				fbink_print(FBFD_AUTO, "[KFMon] send failed ?!", &fbinkConfig);
-			}
-			// Don't retry on write failures, just signal our polling to close the connection
-			return true;
+		if (!queue_ipc_reply(client, buf, 1U)) {
+			return false;
 		}
-	} else if ((strncmp(buf, "start", 5) == 0) || (strncmp(buf, "force-start", 11) == 0) ||
-		   (strncmp(buf, "trigger", 7) == 0) || (strncmp(buf, "force-trigger", 13) == 0)) {
+	} else if ((strncmp(req, "start", 5) == 0) || (strncmp(req, "force-start", 11) == 0) ||
+		   (strncmp(req, "trigger", 7) == 0) || (strncmp(req, "force-trigger", 13) == 0)) {
 		// Discriminate force-*
-		bool force = (buf[0] == 'f');
+		bool force = (req[0] == 'f');
 		// Discriminate trigger from start
-		bool trigger = (force ? buf[6] == 't' : buf[0] == 't');
+		bool trigger = (force ? req[6] == 't' : req[0] == 't');
 		// Pull the actual id out of there. Could have went with strtok, too.
-		uint8_t watch_id                       = WATCH_MAX;
-		char    watch_basename[CFG_SZ_MAX + 1] = { 0 };
-		errno                                  = 0;
-		int n                                  = 0;
+		uint16_t watch_id                       = WATCH_MAX;
+		char     watch_basename[CFG_SZ_MAX + 1] = { 0 };
+		errno                                   = 0;
+		int n                                   = 0;
 		if (force) {
 			if (trigger) {
-				n = sscanf(buf, "force-trigger:%" CFG_SZ_MAX_STR "s", watch_basename);
+				n = sscanf(req, "force-trigger:%" CFG_SZ_MAX_STR "s", watch_basename);
 			} else {
-				n = sscanf(buf, "force-start:%hhu", &watch_id);
+				n = sscanf(req, "force-start:%hu", &watch_id);
 			}
 		} else {
 			if (trigger) {
-				n = sscanf(buf, "trigger:%" CFG_SZ_MAX_STR "s", watch_basename);
+				n = sscanf(req, "trigger:%" CFG_SZ_MAX_STR "s", watch_basename);
 			} else {
-				n = sscanf(buf, "start:%hhu", &watch_id);
+				n = sscanf(req, "start:%hu", &watch_id);
 			}
 		}
 		// We'll add a courtesy reply with the status
 		// NOTE: Actually replying something is *mandatory* in our little IPC "protocol",
 		//       as failing to get a reply in time is the only way a client can figure out that KFMon
-		//       is already busy with a previous IPC connection...
+		//       is too busy to serve it (i.e., it's stuck in the listen backlog, c.f., handle_connection)...
 		int packet_len = 0;
 		if (n == 1) {
 			// Got it! Now check if it's valid...
+			// NOTE: Needs to be an active watch.
 			bool found_watch_idx = false;
-			for (uint8_t watch_idx = 0U; watch_idx < WATCH_MAX; watch_idx++) {
-				// Needs to be an active watch.
-				if (!watchConfig[watch_idx].is_active) {
-					continue;
-				}
-
-				if (trigger) {
-					// trigger looks up by basename(filename)
-					if (strcmp(basename(watchConfig[watch_idx].filename), watch_basename) == 0) {
-						found_watch_idx = true;
-						watch_id        = watch_idx;
-						break;
-					}
-				} else {
-					// start looks up by watch_idx
-					if (watch_id == watch_idx) {
-						found_watch_idx = true;
-						break;
-					}
+			if (trigger) {
+				// trigger looks up by basename(filename)
+				int32_t match = find_watch_by_basename(watch_basename);
+				if (match >= 0) {
+					found_watch_idx = true;
+					watch_id        = (uint16_t) match;
 				}
+			} else {
+				// start looks up by watch_idx
+				found_watch_idx = watch_id < watchListSize && watchConfig[watch_id].is_active;
 			}
 			if (!found_watch_idx) {
 				// Invalid or inactive watch, can't do anything.
@@ -2413,7 +5724,7 @@ static bool
 					    watch_basename);
 				} else {
 					LOG(LOG_WARNING,
-					    "Received a request to %sstart an invalid watch idx %hhu",
+					    "Received a request to %sstart an invalid watch idx %hu",
 					    force ? "force " : "",
 					    watch_id);
 				}
@@ -2428,19 +5739,15 @@ static bool
 					    watch_basename);
 				} else {
 					LOG(LOG_INFO,
-					    "Processing IPC request to %sstart watch idx %hhu",
+					    "Processing IPC request to %sstart watch idx %hu",
 					    force ? "force " : "",
 					    watch_id);
 				}
 
 				// See handle_events for the logic behind spawn blocking & co.
-				bool is_watch_spawned;
-				bool is_blocker_spawned;
-				pthread_mutex_lock(&ptlock);
-				is_watch_spawned   = is_watch_already_spawned(watch_id);
-				is_blocker_spawned = is_blocker_running();
-				pthread_mutex_unlock(&ptlock);
-				bool is_spawn_blocked = are_spawns_blocked();
+				bool is_watch_spawned   = is_watch_already_spawned(watch_id);
+				bool is_blocker_spawned = is_blocker_running();
+				bool is_spawn_blocked   = are_spawns_blocked();
 
 				// Can't force something that is itself a spawn blocker...
 				if (force && watchConfig[watch_id].block_spawns) {
@@ -2454,28 +5761,20 @@ static bool
 				    (!force && !is_watch_spawned && !is_blocker_spawned && !is_spawn_blocked)) {
 					// Skipping the SQL checks implies we don't need the "may still be processing"
 					// logic, either ;).
-					LOG(LOG_INFO,
-					    "Preparing to spawn %s for watch idx %hhu . . .",
-					    watchConfig[watch_id].action,
-					    watch_id);
-					if (watchConfig[watch_id].block_spawns) {
-						LOG(LOG_NOTICE,
-						    "%s is flagged as a spawn blocker, it will prevent *any* event from triggering a spawn while it is still running!",
-						    watchConfig[watch_id].action);
+					if (launch_watch(watch_id)) {
+						packet_len = snprintf(buf, sizeof(buf), "OK\n");
+					} else {
+						// No room for it right now, it'll have to wait its turn
+						int32_t pos = queue_spawn(watch_id, force);
+						packet_len  = pos > 0 ? snprintf(buf, sizeof(buf), "OK_QUEUED:%d\n", pos)
+								      : snprintf(buf, sizeof(buf), "ERR_SPAWN_QUEUE_FULL\n");
 					}
-					// We're using execvp()...
-					char* const cmd[] = { watchConfig[watch_id].action, NULL };
-					spawn(cmd, watch_id);
-					packet_len = snprintf(buf, sizeof(buf), "OK\n");
 				} else {
 					if (is_watch_spawned) {
-						pid_t spid;
-						pthread_mutex_lock(&ptlock);
-						spid = get_spawn_pid_for_watch(watch_id);
-						pthread_mutex_unlock(&ptlock);
+						pid_t spid = get_spawn_pid_for_watch(watch_id);
 
 						LOG(LOG_INFO,
-						    "As watch idx %hhu (%s) still has a spawned process (%ld -> %s) running, we won't be spawning another instance of it!",
+						    "As watch idx %hu (%s) still has a spawned process (%ld -> %s) running, we won't be spawning another instance of it!",
 						    watch_id,
 						    watchConfig[watch_id].filename,
 						    (long) spid,
@@ -2487,14 +5786,16 @@ static bool
 							     basename(watchConfig[watch_id].action));
 						packet_len = snprintf(buf, sizeof(buf), "WARN_ALREADY_RUNNING\n");
 					} else if (!force && is_blocker_spawned) {
+						// NOTE: Unlike a tap, that's an explicit request,
+						//       so, launch it once the blocker is gone.
 						LOG(LOG_INFO,
-						    "As a spawn blocker process is currently running, we won't be spawning anything else to prevent unwanted behavior!");
-						fbink_printf(FBFD_AUTO,
-							     NULL,
-							     &fbinkConfig,
-							     "[KFMon] Not spawning %s: blocked!",
-							     basename(watchConfig[watch_id].action));
-						packet_len = snprintf(buf, sizeof(buf), "WARN_SPAWN_BLOCKED\n");
+						    "As a spawn blocker process is currently running, we'll wait for it to exit before spawning anything else.");
+						int32_t pos = queue_spawn(watch_id, false);
+						if (pos > 0) {
+							packet_len = snprintf(buf, sizeof(buf), "OK_QUEUED:%d\n", pos);
+						} else {
+							packet_len = snprintf(buf, sizeof(buf), "WARN_SPAWN_BLOCKED\n");
+						}
 					} else if (!force && is_spawn_blocked) {
 						LOG(LOG_INFO,
 						    "As the global spawn inhibiter flag is present, we won't be spawning anything!");
@@ -2523,13 +5824,13 @@ static bool
 			}
 		} else {
 			if (trigger) {
-				LOG(LOG_WARNING, "Malformed trigger command: %.*s", (int) len, buf);
+				LOG(LOG_WARNING, "Malformed trigger command: %.*s", (int) len, req);
 				packet_len = snprintf(buf,
 						      sizeof(buf),
 						      "ERR_MALFORMED_CMD\nExpected format is %strigger:name\n",
 						      force ? "force-" : "");
 			} else {
-				LOG(LOG_WARNING, "Malformed start command: %.*s", (int) len, buf);
+				LOG(LOG_WARNING, "Malformed start command: %.*s", (int) len, req);
 				packet_len = snprintf(buf,
 						      sizeof(buf),
 						      "ERR_MALFORMED_CMD\nExpected format is %sstart:id\n",
@@ -2538,34 +5839,58 @@ static bool
 		}
 
 		// Reply with the status (w/ NUL)
-		if (send_in_full(data_fd, buf, (size_t)(packet_len + 1)) < 0) {
-			// Only actual failures are left, so we're pretty much done
-			if (errno == EPIPE) {
-				PFLOG(LOG_WARNING, "Client closed the connection early");
-			} else {
-				PFLOG(LOG_WARNING, "send: %m");
-				fbink_print(FBFD_AUTO, "[KFMon] send failed ?!", &fbinkConfig);
+		if (!queue_ipc_reply(client, buf, (size_t) (packet_len + 1))) {
+			return false;
+		}
+	} else if (strncasecmp(req, "stats", 5) == 0) {
+		LOG(LOG_INFO, "Processing IPC spawn stats request");
+		// Reply with what running each watch's action cost us so far, for every watch that did run something.
+		// Format is id:basename(filename):runs, followed by space separated key=last/average pairs
+		// (except for maxrss_kb, which is last/peak), separated by a LF.
+		for (uint16_t watch_idx = 0U; watch_idx < watchListSize; watch_idx++) {
+			const SpawnStats* stats = &watchConfig[watch_idx].spawn_stats;
+			if (!watchConfig[watch_idx].is_active || stats->runs == 0U) {
+				continue;
+			}
+
+			int packet_len = snprintf(
+			    buf,
+			    sizeof(buf),
+			    "%hu:%s:%u wall_ms=%llu/%llu user_ms=%llu/%llu sys_ms=%llu/%llu maxrss_kb=%llu/%llu majflt=%llu/%llu minflt=%llu/%llu\n",
+			    watch_idx,
+			    basename(watchConfig[watch_idx].filename),
+			    stats->runs,
+			    (unsigned long long) stats->last.wall_ms,
+			    (unsigned long long) (stats->total.wall_ms / stats->runs),
+			    (unsigned long long) stats->last.user_ms,
+			    (unsigned long long) (stats->total.user_ms / stats->runs),
+			    (unsigned long long) stats->last.sys_ms,
+			    (unsigned long long) (stats->total.sys_ms / stats->runs),
+			    (unsigned long long) stats->last.maxrss_kb,
+			    (unsigned long long) stats->total.maxrss_kb,
+			    (unsigned long long) stats->last.majflt,
+			    (unsigned long long) (stats->total.majflt / stats->runs),
+			    (unsigned long long) stats->last.minflt,
+			    (unsigned long long) (stats->total.minflt / stats->runs));
+			// Make sure we reply with that in full (w/o a NUL, we're not done yet) to the client.
+			if (!queue_ipc_reply(client, buf, (size_t) packet_len)) {
+				return false;
 			}
-			// Don't retry on write failures, just signal our polling to close the connection
-			return true;
 		}
-	} else if (strncasecmp(buf, "version", 7) == 0) {
+		// Now that we're done, send a final NUL, just to be nice.
+		buf[0] = '\0';
+		if (!queue_ipc_reply(client, buf, 1U)) {
+			return false;
+		}
+	} else if (strncasecmp(req, "version", 7) == 0) {
 		// Reply with KFMon's short version string.
 		int packet_len = snprintf(buf, sizeof(buf), "KFMon %s\n", KFMON_VERSION);
 
 		// w/ NUL
-		if (send_in_full(data_fd, buf, (size_t)(packet_len + 1)) < 0) {
-			// Only actual failures are left, so we're pretty much done
-			if (errno == EPIPE) {
-				PFLOG(LOG_WARNING, "Client closed the connection early");
-			} else {
-				PFLOG(LOG_WARNING, "send: %m");
-				fbink_print(FBFD_AUTO, "[KFMon] send failed ?!", &fbinkConfig);
-			}
-			// Don't retry on write failures, just signal our polling to close the connection
-			return true;
+		if (!queue_ipc_reply(client, buf, (size_t) (packet_len + 1))) {
+			return false;
 		}
-	} else if (strncasecmp(buf, "full-version", 12) == 0) {
+	} else if (strncasecmp(req, "full-version", 12) == 0) {
 		// Reply with the full KFMon/SQLite/FBink version string.
 		int packet_len = snprintf(buf,
 					  sizeof(buf),
@@ -2577,41 +5902,25 @@ static bool
 					  fbink_version());
 
 		// w/ NUL
-		if (send_in_full(data_fd, buf, (size_t)(packet_len + 1)) < 0) {
-			// Only actual failures are left, so we're pretty much done
-			if (errno == EPIPE) {
-				PFLOG(LOG_WARNING, "Client closed the connection early");
-			} else {
-				PFLOG(LOG_WARNING, "send: %m");
-				fbink_print(FBFD_AUTO, "[KFMon] send failed ?!", &fbinkConfig);
-			}
-			// Don't retry on write failures, just signal our polling to close the connection
-			return true;
+		if (!queue_ipc_reply(client, buf, (size_t) (packet_len + 1))) {
+			return false;
 		}
 	} else {
-		LOG(LOG_WARNING, "Received an invalid/unsupported %zd bytes IPC command: %.*s", len, (int) len, buf);
+		LOG(LOG_WARNING, "Received an invalid/unsupported %zu bytes IPC command: %.*s", len, (int) len, req);
 		// Reply with a list of valid commands, that should be good enough, no need for a full fledged help command.
 		int packet_len = snprintf(
 		    buf,
 		    sizeof(buf),
-		    "ERR_INVALID_CMD\nComma separated list of valid commands: version, full-version, list, gui-list, start, force-start, trigger, force-trigger\n");
+		    "ERR_INVALID_CMD\nComma separated list of valid commands: version, full-version, list, gui-list, stats, start, force-start, trigger, force-trigger\n");
 
 		// w/ NUL
-		if (send_in_full(data_fd, buf, (size_t)(packet_len + 1)) < 0) {
-			// Only actual failures are left, so we're pretty much done
-			if (errno == EPIPE) {
-				PFLOG(LOG_WARNING, "Client closed the connection early");
-			} else {
-				PFLOG(LOG_WARNING, "send: %m");
-				fbink_print(FBFD_AUTO, "[KFMon] send failed ?!", &fbinkConfig);
-			}
-			// Don't retry on write failures, just signal our polling to close the connection
-			return true;
+		if (!queue_ipc_reply(client, buf, (size_t) (packet_len + 1))) {
+			return false;
 		}
 	}
 
 	// Client still has something to say?
-	return false;
+	return true;
 }
 
 // Dirty little helper to pull the command name for a specific PID from procfs
@@ -2704,33 +6013,55 @@ static void
 	}
 }
 
-// Handle a connection attempt on socket 'conn_fd'.
-static void
-    handle_connection(int conn_fd)
+// Handle connection attempts on socket 'conn_fd'.
+static bool
+    handle_connection(int conn_fd, uint32_t events __attribute__((unused)), uint32_t data __attribute__((unused)))
 {
 	// Much like handle_events, we need to ensure fb state is consistent...
-	pthread_mutex_lock(&ptlock);
 	// NOTE: It went fine once, assume that'll still be the case and skip error checking...
 	fbink_reinit(FBFD_AUTO, &fbinkConfig);
-	pthread_mutex_unlock(&ptlock);
-
-	int data_fd = -1;
-	// NOTE: The data fd doesn't inherit the connection socket's flags on Linux.
-	do {
-		data_fd = accept(conn_fd, NULL, NULL);
-	} while (data_fd == -1 && errno == EINTR);
-	if (data_fd == -1) {
-		if (errno == EAGAIN || errno == ECONNABORTED) {
-			// Return early, and let the socket polling trigger a retry or wait for the next connection.
-			// NOTE: That seems to be the right call for ECONNABORTED, too.
-			//       c.f., Go's Accept() wrapper in src/internal/poll/fd_unix.go
-			return;
+
+	// Accept as many pending connections as we have room for
+	while (IPC.count < KFMON_IPC_MAX_CLIENTS) {
+		int data_fd = -1;
+		// NOTE: The data fd doesn't inherit the connection socket's flags on Linux.
+		do {
+			data_fd = accept(conn_fd, NULL, NULL);
+		} while (data_fd == -1 && errno == EINTR);
+		if (data_fd == -1) {
+			if (errno == EAGAIN || errno == ECONNABORTED) {
+				// Return early, and let the event loop trigger a retry or wait for the next connection.
+				// NOTE: That seems to be the right call for ECONNABORTED, too.
+				//       c.f., Go's Accept() wrapper in src/internal/poll/fd_unix.go
+				return false;
+			}
+			PFLOG(LOG_ERR, "Aborting: accept: %m");
+			fbink_print(FBFD_AUTO, "[KFMon] accept failed ?!", &fbinkConfig);
+			exit(EXIT_FAILURE);
 		}
-		PFLOG(LOG_ERR, "Aborting: accept: %m");
-		fbink_print(FBFD_AUTO, "[KFMon] accept failed ?!", &fbinkConfig);
-		exit(EXIT_FAILURE);
+
+		add_ipc_client(data_fd);
+	}
+
+	// NOTE: We're full, so, stop accepting new connections until a slot frees up (c.f., close_ipc_client).
+	//       Pending ones will wait in the listen backlog in the meantime.
+	LOG(LOG_NOTICE, "Serving %u IPC clients, holding off new connections", KFMON_IPC_MAX_CLIENTS);
+	mod_event_source(conn_fd, 0U);
+	return false;
+}
+
+// Setup the state of a freshly accepted IPC connection, and hand it over to the event loop.
+static void
+    add_ipc_client(int data_fd)
+{
+	// Find a free slot (there's always one, c.f., handle_connection)
+	uint8_t idx = 0U;
+	while (IPC.clients[idx].data_fd != -1) {
+		idx++;
 	}
-	// We'll also be poll'ing it, so we want it non-blocking, and CLOEXEC.
+	IpcClient* client = &IPC.clients[idx];
+
+	// It'll be handled by our event loop, too, so we want it non-blocking, and CLOEXEC.
 	// NOTE: We have to do that manually, because accept4 wasn't implemented yet on Mk. 5 kernels...
 	//       (The manpage mentions 2.6.28, but that's the *first* implementation (i.e., on x86).
 	//       On arm, it was only implemented in 2.6.36 (Mk. 5 run on 2.6.35.3)...
@@ -2760,89 +6091,299 @@ static void
 
 	// We'll want to log some information about the client
 	// c.f., https://github.com/troydhanson/network/tree/master/unixdomain/03.pass-pid
-	struct ucred ucred;
-	socklen_t    len = sizeof(ucred);
-	if (getsockopt(data_fd, SOL_SOCKET, SO_PEERCRED, &ucred, &len) == -1) {
+	socklen_t len = sizeof(client->ucred);
+	if (getsockopt(data_fd, SOL_SOCKET, SO_PEERCRED, &client->ucred, &len) == -1) {
 		PFLOG(LOG_WARNING, "getsockopt: %m");
 		fbink_print(FBFD_AUTO, "[KFMon] getsockopt failed ?!", &fbinkConfig);
 		goto cleanup;
 	}
 	// Pull the command name from procfs
-	// NOTE: comm is 16 bytes on Linux
-	char pname[16] = { 0 };
-	get_process_name(ucred.pid, pname);
+	get_process_name(client->ucred.pid, client->pname);
 	// Lookup UID & GID
-	// NOTE: Both fields are 32 bytes on Linux
-	char uname[32] = { 0 };
-	get_user_name(ucred.uid, uname);
-	char gname[32] = { 0 };
-	get_group_name(ucred.gid, gname);
+	get_user_name(client->ucred.uid, client->uname);
+	get_group_name(client->ucred.gid, client->gname);
 
 	// And now we have fancy logging :)
 	LOG(LOG_INFO,
 	    "Handling incoming IPC connection from PID %ld (%s) by user %s:%s",
-	    (long) ucred.pid,
-	    pname,
-	    uname,
-	    gname);
-
-	struct pollfd pfd = { 0 };
-	// Data socket
-	pfd.fd     = data_fd;
-	pfd.events = POLLIN;
-
-	// Wait for data, for a few 15s windows, in order to drop inactive connections after a while
-	size_t retry = 0U;
-	while (1) {
-		int poll_num = poll(&pfd, 1, 15 * 1000);
-		if (poll_num == -1) {
+	    (long) client->ucred.pid,
+	    client->pname,
+	    client->uname,
+	    client->gname);
+
+	// We'll drop the connection if it stays inactive for too long
+	int timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (timer_fd == -1) {
+		PFLOG(LOG_WARNING, "timerfd_create: %m");
+		fbink_print(FBFD_AUTO, "[KFMon] timerfd_create failed ?!", &fbinkConfig);
+		goto cleanup;
+	}
+	const struct itimerspec timeout = { .it_value = { .tv_sec = KFMON_IPC_TIMEOUT } };
+	if (timerfd_settime(timer_fd, 0, &timeout, NULL) == -1) {
+		PFLOG(LOG_WARNING, "timerfd_settime: %m");
+		fbink_print(FBFD_AUTO, "[KFMon] timerfd_settime failed ?!", &fbinkConfig);
+		close(timer_fd);
+		goto cleanup;
+	}
+
+	// Hand both of them over to the event loop, we start by waiting for a command
+	client->data_fd  = data_fd;
+	client->timer_fd = timer_fd;
+	client->events   = EPOLLIN;
+	add_event_source(data_fd, client->events, handle_client, idx);
+	add_event_source(timer_fd, EPOLLIN, handle_client_timeout, idx);
+	IPC.count++;
+	return;
+
+cleanup:
+	close(data_fd);
+}
+
+// Handle activity on the data socket of one of our IPC clients
+static bool
+    handle_client(int data_fd, uint32_t events, uint32_t data)
+{
+	IpcClient* client = &IPC.clients[data];
+
+	// Much like handle_events, we need to ensure fb state is consistent...
+	// NOTE: It went fine once, assume that'll still be the case and skip error checking...
+	fbink_reinit(FBFD_AUTO, &fbinkConfig);
+
+	// Don't even *try* to deal with a connection that was closed by the client,
+	// as we wouldn't be able to reply to it (NOSIGNAL send on closed socket -> EPIPE),
+	// just close it on our end, too, and move on.
+	// NOTE: Said client should already have reported a timeout waiting for our reply,
+	//       so we don't even try to drain its command, and just forget about it.
+	//       On the upside, that prevents said command from being triggered after a random delay.
+	if (events & (EPOLLHUP | EPOLLERR)) {
+		PFLOG(LOG_NOTICE, "Client closed the IPC connection");
+		close_ipc_client(client);
+		return false;
+	}
+
+	// There's data to be read, or the client caught up with (some of) our pending replies,
+	// in which case it may have sent more commands in the meantime, c.f., read_ipc_client.
+	if (events & (EPOLLIN | EPOLLOUT)) {
+		if (!read_ipc_client(client)) {
+			close_ipc_client(client);
+			return false;
+		}
+	}
+
+	bool has_pending_replies = client->woff < client->wlen;
+	if (client->is_closing && !has_pending_replies) {
+		// The client is done talking to us, and we're done replying, we're done!
+		close_ipc_client(client);
+		return false;
+	}
+
+	// NOTE: Only listen for further commands once the client has caught up with our replies,
+	//       so that one that never reads them can't make us queue an ever growing pile of 'em.
+	uint32_t wanted = has_pending_replies ? EPOLLOUT : EPOLLIN;
+	if (wanted != client->events) {
+		mod_event_source(data_fd, wanted);
+		client->events = wanted;
+	}
+
+	// Push the inactivity deadline back
+	const struct itimerspec timeout = { .it_value = { .tv_sec = KFMON_IPC_TIMEOUT } };
+	if (timerfd_settime(client->timer_fd, 0, &timeout, NULL) == -1) {
+		PFLOG(LOG_WARNING, "timerfd_settime: %m");
+	}
+
+	return false;
+}
+
+// One of our IPC clients has been inactive for KFMON_IPC_TIMEOUT seconds
+static bool
+    handle_client_timeout(int timer_fd __attribute__((unused)),
+			  uint32_t events __attribute__((unused)),
+			  uint32_t data)
+{
+	LOG(LOG_NOTICE, "Dropping inactive IPC connection");
+	close_ipc_client(&IPC.clients[data]);
+	return false;
+}
+
+// Handle the complete commands we've already read, until one of them leaves us with a reply to send
+// (caller closes the connection on false).
+static bool
+    handle_ipc_commands(IpcClient* client)
+{
+	size_t start = 0U;
+	for (size_t i = 0U; i < client->rlen && client->woff == client->wlen; i++) {
+		if (client->rbuf[i] == '\0' || client->rbuf[i] == '\n') {
+			client->rbuf[i] = '\0';
+			// NOTE: Skip empty commands (e.g., an LF followed by a NUL).
+			if (i > start && !handle_ipc(client, client->rbuf + start, i - start)) {
+				return false;
+			}
+			start = i + 1U;
+		}
+	}
+	// NOTE: An unterminated command is handled as-is if the client won't send anything else,
+	//       or if it's too large to ever be completed (much like we used to truncate commands to one read).
+	bool is_full = start == 0U && client->rlen == sizeof(client->rbuf) - 1U;
+	if (client->woff == client->wlen && start < client->rlen && (client->is_closing || is_full)) {
+		client->rbuf[client->rlen] = '\0';
+		if (!handle_ipc(client, client->rbuf + start, client->rlen - start)) {
+			return false;
+		}
+		start = client->rlen;
+	}
+	// Keep what's left around for later (be it a partial command, or the ones we haven't gotten to yet)
+	memmove(client->rbuf, client->rbuf + start, client->rlen - start);
+	client->rlen -= start;
+
+	return true;
+}
+
+// Read what the client sent us, handle every complete command, and send our replies
+// (caller closes the connection on false).
+// NOTE: We only ever read more once the client has caught up with our replies,
+//       so that one that pipelines commands without reading them can't make us queue an ever growing pile of 'em.
+//       Whatever it sent in the meantime stays in the socket (or in rbuf) until it does, c.f., handle_client.
+static bool
+    read_ipc_client(IpcClient* client)
+{
+	while (true) {
+		if (!handle_ipc_commands(client)) {
+			return false;
+		}
+		if (client->woff < client->wlen) {
+			if (!flush_ipc_replies(client)) {
+				return false;
+			}
+			if (client->woff < client->wlen) {
+				// The client isn't keeping up, we'll resume once it does.
+				break;
+			}
+			// Caught up, see if there are any commands left to handle
+			continue;
+		}
+
+		// NOTE: Once the client has signaled EoF, there's nothing left to read.
+		if (client->is_closing) {
+			break;
+		}
+
+		// NOTE: Keep room for a NUL, c.f., the unterminated command case in handle_ipc_commands.
+		ssize_t len = read(client->data_fd,    // Flawfinder: ignore
+				   client->rbuf + client->rlen,
+				   sizeof(client->rbuf) - 1U - client->rlen);
+		if (len == -1) {
 			if (errno == EINTR) {
 				continue;
 			}
-			PFLOG(LOG_WARNING, "poll: %m");
-			fbink_print(FBFD_AUTO, "[KFMon] poll failed ?!", &fbinkConfig);
-			goto early_close;
-		}
-
-		if (poll_num > 0) {
-			// Don't even *try* to deal with a connection that was closed by the client,
-			// as we wouldn't be able to reply to it in handle_ipc (NOSIGNAL send on closed socket -> EPIPE),
-			// just close it on our end, too, and move on.
-			// NOTE: Said client should already have reported a timeout waiting for our reply,
-			//       so we don't even try to drain its command, and just forget about it.
-			//       On the upside, that prevents said command from being triggered after a random delay.
-			if (pfd.revents & POLLHUP) {
-				PFLOG(LOG_NOTICE, "Client closed the IPC connection");
-				goto early_close;
-			}
-
-			// There's data to be read!
-			if (pfd.revents & POLLIN) {
-				if (handle_ipc(data_fd)) {
-					// We've successfully handled all input data, we're done!
-					break;
-				}
+			if (errno == EAGAIN) {
+				// We've drained it, wait for more.
+				break;
 			}
+			PFLOG(LOG_WARNING, "read: %m");
+			fbink_print(FBFD_AUTO, "[KFMon] read failed ?!", &fbinkConfig);
+			// Don't retry, as we risk failing here again otherwise.
+			return false;
 		}
 
-		if (poll_num == 0) {
-			// Timed out, increase the retry counter
-			retry++;
+		if (len == 0) {
+			// EoF, the client won't send anything else, but it may still be waiting for our replies.
+			client->is_closing = true;
+		} else {
+			client->rlen += (size_t) len;
 		}
+	}
+
+	return true;
+}
 
-		// Drop the axe after 60s.
-		if (retry >= 4) {
-			LOG(LOG_NOTICE, "Dropping inactive IPC connection");
-			goto early_close;
+// Queue a reply to the client, it'll be sent by flush_ipc_replies (caller closes the connection on false).
+static bool
+    queue_ipc_reply(IpcClient* client, const char* reply, size_t len)
+{
+	// Start by dropping what was already sent
+	if (client->woff > 0U) {
+		memmove(client->wbuf, client->wbuf + client->woff, client->wlen - client->woff);
+		client->wlen -= client->woff;
+		client->woff = 0U;
+	}
+
+	if (client->wlen + len > client->wcap) {
+		size_t new_cap = MAX((size_t) PIPE_BUF, client->wcap * 2U);
+		while (new_cap < client->wlen + len) {
+			new_cap *= 2U;
 		}
+		char* wbuf = realloc(client->wbuf, new_cap);
+		if (wbuf == NULL) {
+			PFLOG(LOG_WARNING, "realloc: %m");
+			return false;
+		}
+		client->wbuf = wbuf;
+		client->wcap = new_cap;
 	}
 
-early_close:
-	// We're done, close the data connection
-	LOG(LOG_INFO, "Closing IPC connection from PID %ld (%s) by user %s:%s", (long) ucred.pid, pname, uname, gname);
+	memcpy(client->wbuf + client->wlen, reply, len);
+	client->wlen += len;
+	return true;
+}
 
-cleanup:
-	close(data_fd);
+// Send as much of our pending replies as the client can take right now (caller closes the connection on false).
+static bool
+    flush_ipc_replies(IpcClient* client)
+{
+	while (client->woff < client->wlen) {
+		ssize_t len = send(client->data_fd,
+				   client->wbuf + client->woff,
+				   client->wlen - client->woff,
+				   MSG_NOSIGNAL | MSG_DONTWAIT);
+		if (len == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			if (errno == EAGAIN) {
+				// The client isn't keeping up, we'll resume once it does.
+				return true;
+			}
+			// Only actual failures are left, so we're pretty much done
+			if (errno == EPIPE) {
+				PFLOG(LOG_WARNING, "Client closed the connection early");
+			} else {
+				PFLOG(LOG_WARNING, "send: %m");
+				fbink_print(FBFD_AUTO, "[KFMon] send failed ?!", &fbinkConfig);
+			}
+			// Don't retry on write failures
+			return false;
+		}
+		client->woff += (size_t) len;
+	}
+
+	// We're all caught up
+	client->wlen = 0U;
+	client->woff = 0U;
+	return true;
+}
+
+// Close the connection with an IPC client, and free its slot
+static void
+    close_ipc_client(IpcClient* client)
+{
+	LOG(LOG_INFO,
+	    "Closing IPC connection from PID %ld (%s) by user %s:%s",
+	    (long) client->ucred.pid,
+	    client->pname,
+	    client->uname,
+	    client->gname);
+
+	remove_event_source(client->timer_fd);
+	close(client->timer_fd);
+	remove_event_source(client->data_fd);
+	close(client->data_fd);
+	free(client->wbuf);
+	*client = (const IpcClient){ .data_fd = -1, .timer_fd = -1 };
+
+	// If we were full, we can go back to accepting new connections
+	if (IPC.count-- == KFMON_IPC_MAX_CLIENTS) {
+		mod_event_source(IPC.listen_fd, EPOLLIN);
+	}
 }
 
 // Handle SQLite logging on error
@@ -2887,7 +6428,14 @@ int
 	    SQLITE_VERSION,
 	    fbink_version());
 
+	// Find out whether our target mountpoint is already mounted, as our configs live there
+	init_mount_monitor();
+
 	// Load our configs
+	if (!grow_watch_list()) {
+		LOG(LOG_ERR, "Failed to allocate the watch list, aborting!");
+		exit(EXIT_FAILURE);
+	}
 	if (load_config() == -1) {
 		LOG(LOG_ERR, "Failed to load daemon config file(s), aborting!");
 		exit(EXIT_FAILURE);
@@ -2912,6 +6460,11 @@ int
 		openlog("kfmon", LOG_CONS | LOG_PID | LOG_NDELAY, LOG_DAEMON);
 	}
 
+	// Fork our zygote now, while we're still small, if we were asked to (c.f., start_zygote)
+	if (daemonConfig.use_zygote) {
+		start_zygote();
+	}
+
 	// Initialize the process table, to track our spawns
 	init_process_table();
 
@@ -2924,6 +6477,17 @@ int
 		exit(EXIT_FAILURE);
 	}
 
+	// Setup our event loop, as everything that follows will hand it fds
+	init_reactor();
+	// NOTE: Keep our view of the mountpoints up to date for the rest of our lifetime, c.f., is_target_mounted.
+	add_event_source(MountMon.fd, EPOLLPRI, handle_mount_events, 0U);
+	if (zygote_fd != -1) {
+		add_event_source(zygote_fd, EPOLLIN, handle_zygote, 0U);
+	}
+
+	// Setup the reaping of our spawns (before we start any thread, because of the signal mask)
+	init_reaper();
+
 	// Initialize SQLite
 	if (sqlite3_config(SQLITE_CONFIG_LOG, sql_errorlogcb, NULL) != SQLITE_OK) {
 		LOG(LOG_ERR, "Failed to setup SQLite, aborting!");
@@ -2933,10 +6497,12 @@ int
 		LOG(LOG_ERR, "Failed to initialize SQLite, aborting!");
 		exit(EXIT_FAILURE);
 	}
+	// All of our SQL happens in a dedicated thread, so that Nickel holding the DB never stalls the main loop.
+	start_db_worker();
 
 	// Setup the IPC socket
 	int conn_fd = -1;
-	// NOTE: We want it non-blocking because we handle incoming connections via poll,
+	// NOTE: We want it non-blocking because we handle incoming connections via our event loop,
 	//       and CLOEXEC not to pollute our spawns.
 	if ((conn_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) == -1) {
 		PFLOG(LOG_ERR, "Failed to create IPC socket (socket: %m), aborting!");
@@ -2954,13 +6520,15 @@ int
 		exit(EXIT_FAILURE);
 	}
 
-	// NOTE: We only accept a single client, as we can only serve 'em one by one anyway.
+	// NOTE: We serve up to KFMON_IPC_MAX_CLIENTS clients concurrently, the backlog only matters once we're full.
 	//       Be aware that, in practice, the kernel will round that up, which means that you can successfully connect,
-	//       send a request, but only get a reply whenever we actually get to it...
-	if (listen(conn_fd, 1) == -1) {
+	//       send a request, but only get a reply whenever a slot frees up...
+	if (listen(conn_fd, KFMON_IPC_MAX_CLIENTS) == -1) {
 		PFLOG(LOG_ERR, "Failed to listen to IPC socket (listen: %m), aborting!");
 		exit(EXIT_FAILURE);
 	}
+	IPC.listen_fd = conn_fd;
+	add_event_source(conn_fd, EPOLLIN, handle_connection, 0U);
 
 	// Now that we're properly up, write a pidfile
 	FILE* pid_f = fopen(KFMON_PID_FILE, "we");
@@ -2991,23 +6559,48 @@ int
 		fbink_print(FBFD_AUTO, "[KFMon] Successfully initialized. :)", &fbinkConfig);
 	}
 
+	// Create the file descriptor for accessing the inotify API
+	// NOTE: We keep it for our whole lifetime, the main loop only ever (re)arms the watches that need it.
+	LOG(LOG_INFO, "Initializing inotify.");
+	raise_inotify_queue_size();
+	inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotify_fd == -1) {
+		PFLOG(LOG_ERR, "Aborting: inotify_init1: %m");
+		fbink_print(FBFD_AUTO, "[KFMon] Failed to initialize inotify!", &fbinkConfig);
+		exit(EXIT_FAILURE);
+	}
+	// NOTE: Everything else (IPC, DB worker, thumbnails & our spawns) is already part of our event loop.
+	add_event_source(inotify_fd, EPOLLIN, handle_events, 0U);
+	// NOTE: If fanotify is available, inotify will only be used to catch unmounts, c.f., arm_fanotify.
+	if (daemonConfig.use_fanotify) {
+		init_fanotify();
+	}
+
 	// We pretty much want to loop forever...
 	while (1) {
 		LOG(LOG_INFO, "Beginning the main loop.");
 
 		// Here, on subsequent iterations, we might be printing stuff *before* handle_events or handle_connection,
 		// (mainly in error-ish codepaths), so we need to check the fb state right now, too...
-		pthread_mutex_lock(&ptlock);
 		// NOTE: It went fine once, assume that'll still be the case and skip error checking...
 		fbink_reinit(FBFD_AUTO, &fbinkConfig);
-		pthread_mutex_unlock(&ptlock);
+
+		// We only ever get here on startup, or after a watch was destroyed (e.g., because of an unmount),
+		// so, make sure the DB worker won't keep using a DB connection that may now be stale.
+		reset_db_worker();
+		// Same deal for the thumbnails we were keeping an eye on
+		if (daemonConfig.watch_thumbnails) {
+			reset_thumbnail_watches();
+		}
 
 		// Make sure our target partition is mounted
 		if (!is_target_mounted()) {
+			enter_exported_state();
 			LOG(LOG_INFO, "%s isn't mounted, waiting for it to be . . .", KFMON_TARGET_MOUNTPOINT);
 			// If it's not, wait for it to be...
 			wait_for_target_mountpoint();
 		}
+		leave_exported_state();
 
 		// Reload *watch* configs to see if we have something new to pickup after an USBMS session
 		// NOTE: Mainly up there for clarity, otherwise it technically belongs at the end of the loop.
@@ -3019,142 +6612,32 @@ int
 			exit(EXIT_FAILURE);
 		}
 
-		// Create the file descriptor for accessing the inotify API
-		LOG(LOG_INFO, "Initializing inotify.");
-		int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
-		if (fd == -1) {
-			PFLOG(LOG_ERR, "Aborting: inotify_init1: %m");
-			fbink_print(FBFD_AUTO, "[KFMon] Failed to initialize inotify!", &fbinkConfig);
-			exit(EXIT_FAILURE);
-		}
-
-		// Flag each of our target files for 'file was opened' and 'file was closed' events
-		// NOTE: We don't check for:
-		//       IN_MODIFY: Highly unlikely (and sandwiched between an OPEN and a CLOSE anyway)
-		//       IN_CREATE: Only applies to directories
-		//       IN_DELETE: Only applies to directories
-		//       IN_DELETE_SELF: Will trigger an IN_IGNORED, which we already handle
-		//       IN_MOVE_SELF: Highly unlikely on a Kobo, and somewhat annoying to handle with our design
-		//           (we'd have to forget about it entirely and not try to re-watch for it
-		//           on the next iteration of the loop).
-		// NOTE: inotify tracks the file's inode, which means that it goes *through* bind mounts, for instance:
-		//           When bind-mounting file 'a' to file 'b', and setting up a watch to the path of file 'b',
-		//           you won't get *any* event on that watch when unmounting that bind mount, since the original
-		//           file 'a' hasn't actually been touched, and, as it is the actual, real file,
-		//           that is what inotify is actually tracking.
-		//       Relative to the earlier IN_MOVE_SELF mention, that means it'll keep tracking the file with its
-		//           new name (provided it was moved to the *same* fs,
-		//           as crossing a fs boundary will delete the original).
-		for (uint8_t watch_idx = 0U; watch_idx < WATCH_MAX; watch_idx++) {
-			// We obviously only care about active watches
-			if (!watchConfig[watch_idx].is_active) {
-				continue;
-			}
-
-			watchConfig[watch_idx].inotify_wd =
-			    inotify_add_watch(fd, watchConfig[watch_idx].filename, IN_OPEN | IN_CLOSE);
-			if (watchConfig[watch_idx].inotify_wd == -1) {
-				// NOTE: Allow running without an actual inotify watch, keeping the action IPC only...
-				//       We could limit this behavior to !hidden watches, or hide it behind another config flag,
-				//       but it's harmless enough to do it unconditionally ;).
-				//       The watch will be released properly if the *config* file gets removed.
-				if (errno == ENOENT) {
-					// Only account for ENOENT, though ;) (i.e., filename is gone).
-					LOG(LOG_NOTICE,
-					    "Setup an IPC-only watch for '%s' @ index %hhu.",
-					    basename(watchConfig[watch_idx].filename),
-					    watch_idx);
-				} else {
-					PFLOG(LOG_WARNING, "inotify_add_watch: %m");
-					LOG(LOG_WARNING,
-					    "Cannot watch '%s', discarding it!",
-					    watchConfig[watch_idx].filename);
-					fbink_printf(FBFD_AUTO,
-						     NULL,
-						     &fbinkConfig,
-						     "[KFMon] Failed to watch %s!",
-						     basename(watchConfig[watch_idx].filename));
-					// NOTE: We used to abort entirely in case even one target file couldn't be watched,
-					//       but that was a bit harsh ;).
-					//       Since the inotify watch couldn't be setup,
-					//       there's no way for this to cause trouble down the road,
-					//       and this allows the user to fix it during an USBMS session,
-					//       instead of having to reboot.
-
-					// If that watch isn't currently running, clear it entirely!
-					pthread_mutex_lock(&ptlock);
-					bool is_watch_spawned = is_watch_already_spawned(watch_idx);
-					pthread_mutex_unlock(&ptlock);
-					if (is_watch_spawned) {
-						LOG(LOG_WARNING,
-						    "Cannot release watch slot %hhu (%s => %s), as it's currently running!",
-						    watch_idx,
-						    basename(watchConfig[watch_idx].filename),
-						    basename(watchConfig[watch_idx].action));
-					} else {
-						watchConfig[watch_idx] = (const WatchConfig){ 0 };
-						// NOTE: This should essentially come down to:
-						//memset(&watchConfig[watch_idx], 0, sizeof(WatchConfig));
-						LOG(LOG_NOTICE, "Released watch slot %hhu.", watch_idx);
-					}
-				}
-			} else {
-				LOG(LOG_NOTICE,
-				    "Setup an inotify watch for '%s' @ index %hhu.",
-				    watchConfig[watch_idx].filename,
-				    watch_idx);
-			}
+		// (Re)arm the inotify watches that need it
+		arm_watches();
+		if (daemonState == DAEMON_RESUMING) {
+			LOG(LOG_NOTICE, "Done resuming after an export.");
+			daemonState = DAEMON_RUNNING;
 		}
 
-		struct pollfd pfds[2] = { 0 };
-		nfds_t        nfds    = 2;
-		// Inotify input
-		pfds[0].fd     = fd;
-		pfds[0].events = POLLIN;
-		// Connection socket
-		pfds[1].fd     = conn_fd;
-		pfds[1].events = POLLIN;
-
 		// Wait for events
+		// NOTE: We'll go back to the main loop if handle_events stops the event loop early
+		//       (because a watch was destroyed automatically after an unmount or an unlink, for instance).
 		LOG(LOG_INFO, "Listening for events.");
-		while (1) {
-			int poll_num = poll(pfds, nfds, -1);
-			if (poll_num == -1) {
-				if (errno == EINTR) {
-					continue;
-				}
-				PFLOG(LOG_ERR, "Aborting: poll: %m");
-				fbink_print(FBFD_AUTO, "[KFMon] poll failed ?!", &fbinkConfig);
-				exit(EXIT_FAILURE);
-			}
-
-			if (poll_num > 0) {
-				if (pfds[0].revents & POLLIN) {
-					// Inotify events are available
-					if (handle_events(fd)) {
-						// Go back to the main loop if we exited early (because a watch was
-						// destroyed automatically after an unmount or an unlink, for instance)
-						break;
-					}
-				}
-
-				if (pfds[1].revents & POLLIN) {
-					// There was a new connection attempt
-					handle_connection(conn_fd);
-				}
-			}
-		}
+		run_reactor();
 		LOG(LOG_INFO, "Stopped listening for events.");
-
-		// Close inotify file descriptor
-		close(fd);
 	}
 
-	// Close the IPC connection socket. Unreachable.
+	// Close the inotify file descriptor. Unreachable.
+	remove_event_source(inotify_fd);
+	close(inotify_fd);
+	// Close the IPC connection socket. Also unreachable.
 	close(conn_fd);
 	unlink(KFMON_IPC_SOCKET);
 	// Release SQLite resources. Also unreachable ;p.
+	stop_db_worker();
 	sqlite3_shutdown();
+	close(Reactor.epfd);
+	free(Reactor.sources);
 	// Why, yes, this is unreachable! Good thing it's also optional ;).
 	if (daemonConfig.use_syslog) {
 		closelog();
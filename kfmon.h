@@ -29,27 +29,36 @@
 #include "inih/ini.h"
 #include "openssh/atomicio.h"
 #include "str5/str5.h"
+#include <ctype.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <fts.h>
 #include <grp.h>
 #include <limits.h>
 #include <linux/limits.h>
-#include <mntent.h>
 #include <poll.h>
 #include <pthread.h>
 #include <pwd.h>
+#include <sched.h>
 #include <signal.h>
+#include <spawn.h>
 #include <sqlite3.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/fanotify.h>
 #include <sys/inotify.h>
 #include <sys/resource.h>
+#include <sys/signalfd.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
+#include <sys/statfs.h>
 #include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#include <sys/timerfd.h>
 #include <sys/time.h>
 #include <sys/types.h>
 #include <sys/un.h>
@@ -77,14 +86,20 @@ extern const char* sqlite3ErrName(int);
 #endif
 // Use my debug paths on demand...
 #ifndef NILUJE
-#	define KOBO_DB_PATH     KFMON_TARGET_MOUNTPOINT "/.kobo/KoboReader.sqlite"
+#	define KOBO_DB_DIR      KFMON_TARGET_MOUNTPOINT "/.kobo"
+#	define KOBO_DB_PATH     KOBO_DB_DIR "/KoboReader.sqlite"
 #	define KFMON_LOGFILE    "/usr/local/kfmon/kfmon.log"
 #	define KFMON_CONFIGPATH KFMON_TARGET_MOUNTPOINT "/.adds/kfmon/config"
 #else
-#	define KOBO_DB_PATH     "/home/niluje/Kindle/Staging/KoboReader.sqlite"
+#	define KOBO_DB_DIR      "/home/niluje/Kindle/Staging"
+#	define KOBO_DB_PATH     KOBO_DB_DIR "/KoboReader.sqlite"
 #	define KFMON_LOGFILE    "/home/niluje/Kindle/Staging/kfmon.log"
 #	define KFMON_CONFIGPATH "/home/niluje/Kindle/Staging/kfmon"
 #endif
+// Nickel's DB rollback journal, relative to KOBO_DB_DIR (c.f., wait_for_db_journal)
+#define KOBO_DB_JOURNAL_NAME "KoboReader.sqlite-journal"
+// And its write-ahead log, as that's where commits land first in WAL mode (c.f., get_db_stamps)
+#define KOBO_DB_WAL_PATH KOBO_DB_PATH "-wal"
 
 // Path to our pidfile
 #define KFMON_PID_FILE "/var/run/kfmon.pid"
@@ -92,6 +107,15 @@ extern const char* sqlite3ErrName(int);
 // Path to our IPC Unix socket
 #define KFMON_IPC_SOCKET "/tmp/kfmon-ipc.ctl"
 
+// Where we create the cgroups our spawns are confined to, if asked to (c.f., setup_spawn_cgroup)
+// NOTE: That's the usual cgroup v2 mountpoint
+#define KFMON_CGROUP_ROOT "/sys/fs/cgroup"
+#define KFMON_CGROUP_PATH KFMON_CGROUP_ROOT "/kfmon"
+// NOTE: Our TC's <linux/magic.h> may predate cgroup v2
+#ifndef CGROUP2_SUPER_MAGIC
+#	define CGROUP2_SUPER_MAGIC 0x63677270
+#endif
+
 // MIN/MAX with no side-effects,
 // c.f., https://gcc.gnu.org/onlinedocs/cpp/Duplication-of-Side-Effects.html#Duplication-of-Side-Effects
 //     & https://dustri.org/b/min-and-max-macro-considered-harmful.html
@@ -127,19 +151,6 @@ extern const char* sqlite3ErrName(int);
 // Same, but with __PRETTY_FUNCTION__ right before fmt
 #define PFLOG(prio, fmt, ...) ({ LOG(prio, "[%s] " fmt, __PRETTY_FUNCTION__, ##__VA_ARGS__); })
 
-// Slight variation without date/time handling to ensure thread safety
-#define MTLOG(prio, fmt, ...)                                                                                            \
-	({                                                                                                               \
-		if (daemonConfig.use_syslog) {                                                                           \
-			syslog(prio, fmt, ##__VA_ARGS__);                                                                \
-		} else {                                                                                                 \
-			fprintf(stderr, "[KFMon] " fmt "\n", ##__VA_ARGS__);                                             \
-		}                                                                                                        \
-	})
-
-// Same, but with __PRETTY_FUNCTION__ right before fmt
-#define PFMTLOG(prio, fmt, ...) ({ MTLOG(prio, "[%s] " fmt, __PRETTY_FUNCTION__, ##__VA_ARGS__); })
-
 // Some extra verbose stuff is relegated to DEBUG builds... (c.f., https://stackoverflow.com/questions/1644868)
 #ifdef DEBUG
 #	define DEBUG_LOG 1
@@ -182,49 +193,420 @@ typedef struct
 	unsigned short int db_timeout;
 	bool               use_syslog;
 	bool               with_notifications;
+	bool               watch_thumbnails;
+	bool               watch_directories;
+	bool               use_fanotify;
+	bool               use_zygote;
 } DaemonConfig;
 
+// Just enough to tell whether a file changed while our target mountpoint was exported (c.f., leave_exported_state)
+typedef struct
+{
+	struct timespec mtime;
+	off_t           size;
+} FileStamp;
+
+// What we remember about a watch's entry in Nickel's DB after a lookup (c.f., is_target_processed)
+typedef struct
+{
+	int64_t   data_version;
+	uint32_t  db_generation;
+	char      image_id[KFMON_PATH_MAX];
+	// What the DB (& its WAL) looked like right before that lookup
+	FileStamp db_stamp;
+	FileStamp wal_stamp;
+	bool      is_valid;
+	bool      exists;
+	bool      title_matches;
+	bool      is_processed;
+	// Survived an export, and still needs to be rebased on our current DB connection
+	bool      is_carried_over;
+} DbVerdict;
+
+// Keep track of the thumbnails Nickel generates for a watch's icon via inotify (c.f., arm_thumbnail_watch)
+// NOTE: Nickel may not have created the shard directory yet, in which case we watch its closest existing parent,
+//       and move down the hierarchy as it gets created.
+typedef struct
+{
+	char     image_id[KFMON_PATH_MAX];
+	// 0 when we're not watching anything
+	int      wd;
+	// The other watches waiting on the same directory (and thus sharing that wd), -1 terminated.
+	// NOTE: Only meaningful when wd is set. Only the first one is indexed (c.f., link_thumbnail_watch).
+	int32_t  prev;
+	int32_t  next;
+	// The last thumbnails event we've handled for it (c.f., handle_thumbnail_events)
+	uint32_t event_seq;
+	// How deep in .kobo-images the watched directory is (THUMBS_SHARD_DEPTH being the actual shard directory)
+	uint8_t  depth;
+	// Bitmask of the thumbnails we've seen appear (c.f., thumbnail_kinds)
+	uint8_t  seen;
+	bool     is_ready;
+} ThumbsState;
+#define THUMBS_SHARD_DEPTH 2U
+#define THUMBS_ALL_SEEN    0x07U
+// Files appear in the shard directory, directories in its parents
+#define THUMBS_WATCH_MASK  (IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_ONLYDIR)
+// The thumbnails Nickel generates for an icon, in ThumbsState.seen bit order
+static const char* const thumbnail_kinds[] = { "N3_FULL", "N3_LIBRARY_FULL", "N3_LIBRARY_GRID" };
+
+// What we've seen happen to a watch's target file during the batch of events we're currently processing
+typedef struct
+{
+	// IN_OPEN and/or IN_CLOSE
+	uint32_t mask;
+	// The last one of those we've seen
+	uint32_t last;
+	// How many events we've coalesced (0 when the watch isn't part of the current batch)
+	uint16_t count;
+	// Next watch idx in the current batch, or -1
+	int32_t  next;
+} EventSummary;
+
+// Where a watch stands w/ regards to Nickel's processing of its target file (c.f., set_watch_state)
+typedef enum
+{
+	// Nothing to report, events are honored as-is
+	WATCH_IDLE = 0,
+	// Nickel hasn't processed it yet, we'll check again regularly, for up to pending_timeout seconds
+	WATCH_PENDING,
+	// Nickel has only just processed it, don't trust events for settle_delay seconds
+	WATCH_SETTLING,
+	// Nickel processed it, and it has settled
+	WATCH_READY
+} WatchState;
+// How often we check whether a pending target file has been processed yet (in seconds)
+#define WATCH_PENDING_RECHECK 5U
+// Defaults for the pending_timeout & settle_delay watch keys (in seconds)
+#define WATCH_PENDING_TIMEOUT 60U
+#define WATCH_SETTLE_DELAY    10U
+
+// What running a watch's action cost us (c.f., record_spawn_usage)
+typedef struct
+{
+	uint64_t wall_ms;
+	uint64_t user_ms;
+	uint64_t sys_ms;
+	// NOTE: ru_maxrss is in kB on Linux
+	uint64_t maxrss_kb;
+	uint64_t majflt;
+	uint64_t minflt;
+} SpawnUsage;
+typedef struct
+{
+	SpawnUsage last;
+	// Summed over every run, except for maxrss_kb, which is the peak
+	SpawnUsage total;
+	// NOTE: Only counts the runs we actually got resource usage for (c.f., stop_zygote)
+	uint32_t   runs;
+} SpawnStats;
+
+// How a watch's spawns should be run (c.f., fork_and_exec), every field is optional
+typedef struct
+{
+	// Only honored if the matching has_* flag is set
+	int      nice;
+	int      oom_score_adj;
+	// Already packed for ioprio_set (c.f., IOPRIO_PRIO_VALUE), 0 meaning unset
+	int      ioprio;
+	// One bit per CPU (so, only the first 32), 0 meaning unset
+	uint32_t cpu_affinity;
+	// Written as-is to the matching files of its cgroup, empty meaning unset (c.f., setup_spawn_cgroup)
+	char     memory_max[32];
+	char     cpu_max[32];
+	bool     has_nice;
+	bool     has_oom_score_adj;
+} SpawnPolicy;
+
 // What a watch config should look like
 typedef struct
 {
-	time_t processing_ts;
-	int    inotify_wd;
-	char   filename[CFG_SZ_MAX];
-	char   action[CFG_SZ_MAX];
-	char   label[CFG_SZ_MAX];
-	char   db_title[DB_SZ_MAX];
-	char   db_author[DB_SZ_MAX];
-	char   db_comment[DB_SZ_MAX];
-	bool   hidden;
-	bool   skip_db_checks;
-	bool   do_db_update;
-	bool   block_spawns;
-	bool   wd_was_destroyed;
-	bool   pending_processing;
-	bool   is_active;
+	DbVerdict          db_cache;
+	ThumbsState        thumbs;
+	EventSummary       batch;
+	WatchState         state;
+	// When we entered that state (CLOCK_MONOTONIC_RAW)
+	time_t             state_ts;
+	// Backs the PENDING & SETTLING timeouts, 0 when we don't need one (fd 0 being /dev/null, c.f., daemonize)
+	int                state_fd;
+	int                inotify_wd;
+	char               filename[CFG_SZ_MAX];
+	char               action[CFG_SZ_MAX];
+	char               label[CFG_SZ_MAX];
+	char               db_title[DB_SZ_MAX];
+	char               db_author[DB_SZ_MAX];
+	char               db_comment[DB_SZ_MAX];
+	// 0 meaning the default (c.f., WATCH_PENDING_TIMEOUT & WATCH_SETTLE_DELAY)
+	unsigned short int pending_timeout;
+	unsigned short int settle_delay;
+	bool               hidden;
+	bool               skip_db_checks;
+	bool               do_db_update;
+	bool               block_spawns;
+	// How many CLOSE events we've seen since we started SETTLING
+	uint8_t            settle_closes;
+	// Spawn as soon as we're done SETTLING
+	bool               deferred_spawn;
+	bool               is_active;
+	// Offset of the basename in filename, computed once on registration (c.f., get_watch_basename)
+	uint8_t            basename_ofs;
+	// The config file it was loaded from, and what it looked like at the time (c.f., set_watch_config_file)
+	char               config_name[CFG_SZ_MAX];
+	FileStamp          config_stamp;
+	// Exposed over IPC, c.f., handle_ipc
+	SpawnStats         spawn_stats;
+	SpawnPolicy        policy;
 } WatchConfig;
 
-// Hardcode the max amount of watches we handle
-// NOTE: Cannot exceed INT8_MAX!
-#define WATCH_MAX 16
+// Our watch list is grown on demand (c.f., grow_watch_list), starting with WATCH_MIN slots.
+// NOTE: WATCH_MAX cannot exceed UINT16_MAX, as that's the type we use for watch indices
+//       (with int32_t used wherever we need to be able to return -1 instead).
+#define WATCH_MIN 16U
+#define WATCH_MAX UINT16_MAX
+static bool grow_watch_list(void);
+
+// Index our active watches by inotify wd, filename & basename, so we never have to scan the whole watch list.
+// As well as by the wd of the thumbnails directory they're waiting on, if any (c.f., link_thumbnail_watch).
+// Each index is an open-addressed hash table (w/ linear probing) of watch indices, -1 meaning empty.
+// NOTE: Their size is always a power of two, and at least four times the size of the watch list,
+//       to keep the probe sequences short.
+typedef enum
+{
+	WATCH_KEY_WD = 0,
+	WATCH_KEY_FILENAME,
+	WATCH_KEY_BASENAME,
+	WATCH_KEY_CONFIG,
+	WATCH_KEY_THUMBS_WD,
+	WATCH_KEY_COUNT
+} WatchKeyId;
+
+struct watch_registry
+{
+	int32_t* slots[WATCH_KEY_COUNT];
+	uint32_t size;
+};
+static uint32_t    hash_watch_str(const char*);
+static uint32_t    hash_watch_key(WatchKeyId, int, const char*);
+static bool        watch_key_matches(WatchKeyId, uint16_t, int, const char*);
+static uint32_t    hash_watch_entry(WatchKeyId, uint16_t);
+static void        insert_watch_key(WatchKeyId, uint16_t);
+static int32_t     find_watch_key(WatchKeyId, int, const char*);
+static void        erase_watch_key(WatchKeyId, uint16_t);
+static bool        resize_watch_registry(uint32_t);
+static void        register_watch(uint16_t);
+static void        unregister_watch(uint16_t);
+static void        set_watch_wd(uint16_t, int);
+static int32_t     find_watch_by_wd(int);
+static int32_t     find_watch_by_filename(const char*);
+static int32_t     find_watch_by_basename(const char*);
+static int32_t     find_watch_by_config(const char*);
+static void        set_watch_config_file(uint16_t, const char*, const FileStamp*);
+static const char* get_watch_basename(uint16_t);
+
+// Our event loop: a single epoll instance, which dispatches events to the handler registered for each fd.
+// NOTE: Handlers get the fd, the epoll events, and the data they were registered with (e.g., a process table entry).
+//       Much like handle_events used to, they return true to stop the loop (c.f., main).
+typedef bool (*EventHandler)(int, uint32_t, uint32_t);
+typedef struct
+{
+	EventHandler handler;
+	uint32_t     data;
+	// NOTE: Bumped on each registration, so that we can tell stale events apart after an fd has been recycled.
+	uint32_t gen;
+} EventSource;
+struct reactor
+{
+	// NOTE: Indexed by fd, grown on demand.
+	EventSource* sources;
+	int          size;
+	int          epfd;
+} Reactor = { .epfd = -1 };
+static void init_reactor(void);
+static void add_event_source(int, uint32_t, EventHandler, uint32_t);
+static void mod_event_source(int, uint32_t);
+static void remove_event_source(int);
+static void run_reactor(void);
 
 // Used to keep track of our spawned processes, by storing their pids, and their watch idx.
 // c.f., https://stackoverflow.com/a/35235950 & https://stackoverflow.com/a/8976461
 // As well as issue #2 for details of past failures w/ a SIGCHLD handler
+// NOTE: Grown on demand, as we can't have more running spawns than watches.
+//       Only ever touched by the main thread, as that's also where the reaping happens (c.f., reap_process).
+//       We also keep enough bookkeeping around that none of our spawn checks ever have to walk it.
 struct process_table
 {
-	pid_t spawn_pids[WATCH_MAX];
+	// NOTE: 0 while our zygote has yet to tell us what it launched (c.f., handle_zygote_reply).
+	pid_t*           spawn_pids;
 	// NOTE: Needs to be signed because we use -1 as a special value meaning 'available'.
-	int8_t spawn_watchids[WATCH_MAX];
+	int32_t*         spawn_watchids;
+	// NOTE: -1 if we're relying on SIGCHLD instead.
+	int*             spawn_pidfds;
+	// Launched by our zygote (i.e., not our child, c.f., stop_zygote)
+	bool*            spawn_via_zygote;
+	// When it was launched (CLOCK_MONOTONIC_RAW)
+	struct timespec* spawn_times;
+	// NOTE: We keep its watch's filename around to make sure the watch slot wasn't recycled in the meantime
+	//       (c.f., record_spawn_usage). CFG_SZ_MAX bytes per entry.
+	char*            spawn_filenames;
+	// Whether that spawn is currently accounted for in blockers (c.f., update_spawn_blocker)
+	bool*            spawn_blocks;
+	// One bit per entry, set when it's available (c.f., get_next_available_pt_entry)
+	uint32_t*        free_map;
+	// Which entry holds each watch's spawn, -1 if it doesn't have one running (sized like the watch list)
+	int32_t*         watch_slots;
+	uint16_t         watch_slots_size;
+	uint16_t         size;
+	// How many of our running spawns are flagged as spawn blockers
+	uint16_t         blockers;
 } PT;    // lgtm [cpp/short-global-name]
-pthread_mutex_t ptlock = PTHREAD_MUTEX_INITIALIZER;
-static void     init_process_table(void);
-static int8_t   get_next_available_pt_entry(void);
-static void     add_process_to_table(uint8_t, pid_t, uint8_t);
-static void     remove_process_from_table(uint8_t);
+static void    init_process_table(void);
+static bool    grow_process_table(void);
+static bool    grow_pt_watch_slots(uint16_t);
+static int32_t get_next_available_pt_entry(void);
+static void    add_process_to_table(uint16_t, pid_t, uint16_t, bool);
+static void    remove_process_from_table(uint16_t);
+static void    update_spawn_blocker(uint16_t);
+
+// Launch requests we couldn't honor right away (because of a spawn blocker, or a full process table) wait in here,
+// and are dispatched in order as soon as they can be (c.f., dispatch_spawn_queue), unless they expire first.
+// NOTE: Taps on a target icon while a blocker is running are *not* queued, though, as filtering those out
+//       is the whole point of block_spawns (c.f., is_blocker_running).
+#define SPAWN_QUEUE_MAX 8U
+// How long a queued request stays valid (in seconds)
+#define SPAWN_QUEUE_TIMEOUT 30U
+typedef struct
+{
+	// When it expires (CLOCK_MONOTONIC_RAW)
+	time_t   deadline;
+	// NOTE: We keep the filename around to make sure the watch slot wasn't recycled in the meantime (c.f., DbJob)
+	char     filename[CFG_SZ_MAX];
+	uint16_t watch_idx;
+	// Ignore spawn blockers (c.f., handle_ipc)
+	bool     force;
+} SpawnRequest;
+struct spawn_queue
+{
+	SpawnRequest requests[SPAWN_QUEUE_MAX];
+	uint8_t      count;
+} SpawnQueue;
+static int32_t queue_spawn(uint16_t, bool);
+static void    prune_spawn_queue(void);
+static void    dispatch_spawn_queue(void);
+static void    clear_spawn_queue(void);
+
+// pidfd_open(2) appeared in Linux 5.3, so our TC's headers may very well not know about it.
+// NOTE: It's one of the new-style syscalls, which share the same number on every arch.
+#ifndef SYS_pidfd_open
+#	define SYS_pidfd_open 434
+#endif
+
+// How we learn about our spawns' deaths: either via one pidfd per spawn in our event loop,
+// or, on kernels without pidfd support, via a signalfd for SIGCHLD (in which case use_pidfd is false).
+bool            use_pidfd  = false;
+int             sigchld_fd = -1;
+static void     init_reaper(void);
+static void     use_sigchld_fd(void);
+static int      open_pidfd(pid_t);
+static void     reap_process(uint16_t, int, const struct rusage*);
+static void     record_spawn_usage(uint16_t, const struct rusage*);
+static bool     is_spawn_watch_current(uint16_t);
+static uint64_t timeval_to_ms(const struct timeval*);
+static bool     handle_pidfd(int, uint32_t, uint32_t);
+static bool     handle_sigchld(int, uint32_t, uint32_t);
 
 static void init_fbink_config(void);
 
+// Release our DB connections after that many seconds of inactivity,
+// so that we never hold the target mountpoint busy when Nickel wants to unmount it (e.g., for USBMS).
+#define KFMON_DB_IDLE_TIMEOUT 10
+
+// The queries we keep prepared on our long-lived DB connections (c.f., is_target_processed)
+typedef enum
+{
+	DB_STMT_CONTENT = 0,
+	DB_STMT_DATA_VERSION,
+	// NOTE: Only this one lives on the read-write connection
+	DB_STMT_UPDATE,
+	DB_STMT_COUNT
+} DbStmtId;
+
+// Keep track of our connections to Nickel's DB, and of the statements prepared on them.
+// The read-only connection is used for every check, the read-write one only ever for do_db_update.
+// Both are opened lazily, and closed when the DB file changes underneath us (e.g., unmount/remount),
+// or when they've been idle for KFMON_DB_IDLE_TIMEOUT.
+struct db_connections
+{
+	sqlite3*      ro_db;
+	sqlite3*      rw_db;
+	sqlite3_stmt* stmts[DB_STMT_COUNT];
+	dev_t         db_dev;
+	ino_t         db_ino;
+	// Bumped every time we (re)open the read-only connection, as data_version is only meaningful per-connection.
+	uint32_t      generation;
+} DBC;    // lgtm [cpp/short-global-name]
+static sqlite3*      get_kobo_db(bool);
+static sqlite3_stmt* get_db_stmt(DbStmtId);
+static void          release_db_stmt(sqlite3_stmt*);
+static void          close_kobo_db(void);
+static int64_t       get_db_data_version(void);
+
+// Don't wait for Nickel's rollback journal to go away for longer than that many seconds
+#define KFMON_DB_JOURNAL_TIMEOUT 10
+static void wait_for_db_journal(void);
+
+// A DB check request, handed over to the DB worker thread (c.f., db_worker_thread).
+// It carries a copy of everything is_target_processed needs, so the worker never has to touch watchConfig.
+typedef struct
+{
+	DbVerdict db_cache;
+	char      filename[CFG_SZ_MAX];
+	char      db_title[DB_SZ_MAX];
+	char      db_author[DB_SZ_MAX];
+	char      db_comment[DB_SZ_MAX];
+	// Only meaningful when thumbs_tracked is set, c.f., watch_thumbnails
+	char      thumbs_image_id[KFMON_PATH_MAX];
+	uint16_t  watch_idx;
+	bool      skip_db_checks;
+	bool      do_db_update;
+	bool      thumbs_tracked;
+	bool      thumbs_ready;
+	// NOTE: Set for IN_CLOSE checks, which are the ones that may lead to a spawn.
+	bool      wait_for_db;
+	bool      is_processed;
+} DbJob;
+
+// How many DB checks we allow to be in flight at once (queued, running, or waiting to be picked up by the main thread)
+#define DB_JOB_MAX 32U
+
+// The queues shared between the main thread & the DB worker thread, both protected by lock.
+// The worker signals completed jobs by bumping the eventfd, which the main thread polls alongside everything else.
+struct db_worker
+{
+	DbJob           pending[DB_JOB_MAX];
+	DbJob           done[DB_JOB_MAX];
+	uint8_t         pending_head;
+	uint8_t         pending_count;
+	uint8_t         done_head;
+	uint8_t         done_count;
+	uint8_t         in_flight;
+	bool            reset_db;
+	bool            quit;
+	int             efd;
+	pthread_t       thread;
+	pthread_mutex_t lock;
+	pthread_cond_t  cond;
+} DBW = { .efd = -1, .lock = PTHREAD_MUTEX_INITIALIZER };    // lgtm [cpp/short-global-name]
+static void* db_worker_thread(void*);
+static void  start_db_worker(void);
+static void  stop_db_worker(void);
+static void  reset_db_worker(void);
+static bool  queue_db_check(uint16_t, bool);
+static bool  handle_db_results(int, uint32_t, uint32_t);
+static void  handle_db_verdict(const DbJob*);
+static void  set_watch_state(uint16_t, WatchState);
+static bool  handle_watch_timer(int, uint32_t, uint32_t);
+static bool  launch_watch(uint16_t);
+
 // SQLite macros inspired from http://www.lemoda.net/c/sqlite-insert/ :)
 #define CALL_SQLITE(f)                                                                                                   \
 	({                                                                                                               \
@@ -245,47 +627,280 @@ static int daemonize(void);
 static struct tm*  get_localtime(struct tm* restrict);
 static char*       format_localtime(struct tm* restrict, char* restrict, size_t);
 static char*       get_current_time(void);
-static char*       get_current_time_r(struct tm* restrict, char* restrict, size_t);
 static const char* get_log_prefix(int) __attribute__((const));
 
-static bool is_target_mounted(void);
-static void wait_for_target_mountpoint(void);
-
-static int    strtoul_hu(const char*, unsigned short int* restrict);
-static int    strtobool(const char* restrict, bool* restrict);
-static int    daemon_handler(void*, const char* restrict, const char* restrict, const char* restrict);
-static int    watch_handler(void*, const char* restrict, const char* restrict, const char* restrict);
-static bool   validate_watch_config(void*);
-static bool   validate_and_merge_watch_config(void*, uint8_t, bool*);
-static int8_t get_next_available_watch_entry(void);
-static int    fts_alphasort(const FTSENT**, const FTSENT**);
-static int    load_config(void);
-static int    update_watch_configs(void);
+// Keep track of our target mountpoint via /proc/self/mountinfo, which the kernel lets us poll for changes.
+// NOTE: We keep a sorted snapshot of the key of every mount (i.e., its ID & a hash of its mountpoint),
+//       so that on each change, we only have to look at the entries that actually changed.
+typedef enum
+{
+	MOUNT_UNKNOWN = 0,
+	MOUNT_ABSENT,
+	MOUNT_PRESENT,
+} MountState;
+struct mount_monitor
+{
+	uint64_t*  keys;
+	uint64_t*  scratch;
+	size_t     count;
+	size_t     size;
+	// NOTE: The raw mountinfo contents, reused across scans.
+	char*      buf;
+	size_t     buf_size;
+	// NOTE: Key of the topmost mount sitting on our target mountpoint, 0 if there isn't one.
+	uint64_t   target_key;
+	MountState state;
+	int        fd;
+} MountMon = { .fd = -1 };
+static void     init_mount_monitor(void);
+static bool     read_mountinfo(void);
+static bool     parse_mountinfo_line(const char*, const char*, uint32_t*, const char**, size_t*);
+static uint64_t get_mount_key(uint32_t, const char*, size_t);
+static int      compare_mount_keys(const void*, const void*);
+static bool     grow_mount_keys(size_t);
+static uint64_t scan_mountinfo(bool, size_t*, size_t*);
+static void     set_mount_state(MountState);
+static void     refresh_mount_state(void);
+static bool     handle_mount_events(int, uint32_t, uint32_t);
+static bool     is_target_mounted(void);
+static void     wait_for_target_mountpoint(void);
+
+// When our target mountpoint goes away while we're running (i.e., it's being exported over USBMS),
+// we park everything until it comes back, and then only reload what actually changed in the meantime.
+typedef enum
+{
+	DAEMON_RUNNING = 0,
+	DAEMON_EXPORTED,
+	// Back from an export, until we're done reloading our watches (c.f., update_watch_configs)
+	DAEMON_RESUMING,
+} DaemonState;
+DaemonState daemonState = DAEMON_RUNNING;
+static bool get_file_stamp(const char*, FileStamp*);
+static bool is_same_file_stamp(const FileStamp*, const FileStamp*);
+static void get_db_stamps(FileStamp*, FileStamp*);
+static void enter_exported_state(void);
+static void leave_exported_state(void);
+
+static int     strtoul_hu(const char*, unsigned short int* restrict);
+static int     strtol_i(const char*, int* restrict);
+static int     strtobool(const char* restrict, bool* restrict);
+static int     parse_ionice(const char*, int* restrict);
+static int     parse_cpu_list(const char*, uint32_t* restrict);
+static int     parse_cgroup_value(const char*, char* restrict, size_t);
+static bool    is_same_spawn_policy(const SpawnPolicy*, const SpawnPolicy*);
+static int     daemon_handler(void*, const char* restrict, const char* restrict, const char* restrict);
+static int     watch_handler(void*, const char* restrict, const char* restrict, const char* restrict);
+static bool    validate_watch_config(void*);
+static bool    validate_and_merge_watch_config(void*, uint16_t, bool*);
+static int32_t get_next_available_watch_entry(void);
+static int     fts_alphasort(const FTSENT**, const FTSENT**);
+static int     load_config(void);
+static int     update_watch_configs(void);
 // Make our config global, because I'm terrible at C.
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wmissing-braces"
 DaemonConfig           daemonConfig           = { 0 };
-WatchConfig            watchConfig[WATCH_MAX] = { 0 };
+WatchConfig*           watchConfig            = NULL;
+uint16_t               watchListSize          = 0U;
+struct watch_registry  watchRegistry          = { 0 };
 FBInkConfig            fbinkConfig            = { 0 };
 #pragma GCC diagnostic push
 
 static unsigned int qhash(const unsigned char* restrict, size_t);
-static bool         is_target_processed(uint8_t, bool);
-
-static void* reaper_thread(void*);
-static pid_t spawn(char* const*, uint8_t);
+static void         set_db_busy_timeout(sqlite3*, bool);
+static void         get_images_path(const char*, char*, size_t);
+static bool         are_thumbnails_processed(const char*);
+
+// Our inotify instance for the thumbnails' directories, when watch_thumbnails is enabled
+int         thumbs_fd        = -1;
+uint32_t    thumbs_event_seq = 0U;
+static void reset_thumbnail_watches(void);
+static void link_thumbnail_watch(uint16_t, int);
+static bool unlink_thumbnail_watch(uint16_t);
+static void drop_thumbnail_watch(uint16_t);
+static void arm_thumbnail_watch(uint16_t, const char*);
+static bool handle_thumbnail_events(int, uint32_t, uint32_t);
+static bool         is_target_processed(DbJob*);
+
+// ioprio_set(2) has no glibc wrapper, and the constants live in a kernel header our TC may not ship.
+#ifndef IOPRIO_CLASS_SHIFT
+#	define IOPRIO_CLASS_SHIFT             13
+#	define IOPRIO_PRIO_VALUE(class, data) (((class) << IOPRIO_CLASS_SHIFT) | (data))
+#	define IOPRIO_CLASS_RT                1
+#	define IOPRIO_CLASS_BE                2
+#	define IOPRIO_CLASS_IDLE              3
+#	define IOPRIO_WHO_PROCESS             1
+#endif
 
-static bool  is_watch_already_spawned(uint8_t);
+static pid_t posix_spawn_process(char* const*);
+static pid_t fork_process(char* const*, uint16_t);
+static pid_t fork_and_exec(char* const*, const SpawnPolicy*, int);
+static bool  spawn(char* const*, uint16_t);
+static void  spawn_directly(uint16_t, char* const*, uint16_t);
+static void  report_spawn(uint16_t);
+static bool  is_spawn_cgroup_set(const SpawnPolicy*);
+static bool  is_spawn_policy_set(const SpawnPolicy*);
+static void  fill_spawn_cpu_set(const SpawnPolicy*, cpu_set_t*);
+static bool  write_cgroup_file(const char*, const char*);
+static int   setup_spawn_cgroup(uint16_t);
+
+// When use_zygote is enabled, our spawns are launched by a tiny helper process instead (c.f., start_zygote),
+// forked before we've had a chance to grow (i.e., before SQLite, FBInk, or any thread).
+// We send it ZygoteRequests over a socketpair, and it sends ZygoteReplies back.
+// NOTE: Requests are answered asynchronously (c.f., handle_zygote), in order,
+//       so we tag them with the process table entry we've reserved for them.
+typedef struct
+{
+	char        action[CFG_SZ_MAX];
+	// NOTE: Save for its cgroup, which only we can setup (c.f., spawn).
+	SpawnPolicy policy;
+	uint16_t    entry;
+} ZygoteRequest;
+typedef enum
+{
+	// In answer to a request (pid is -1 if the spawn failed)
+	ZYGOTE_SPAWNED = 0,
+	// Whenever one of its spawns dies, as only it can reap them
+	ZYGOTE_REAPED,
+} ZygoteReplyType;
+typedef struct
+{
+	ZygoteReplyType type;
+	pid_t           pid;
+	int             wstatus;
+	// NOTE: Only set for ZYGOTE_REAPED, c.f., record_spawn_usage
+	struct rusage   rusage;
+	// NOTE: Only set for ZYGOTE_SPAWNED, c.f., ZygoteRequest
+	uint16_t        entry;
+} ZygoteReply;
+// How long we let the zygote sit on a spawn request before giving up on it (in ms, c.f., handle_zygote_timeout)
+#define KFMON_ZYGOTE_TIMEOUT 1000
+pid_t       zygote_pid      = -1;
+int         zygote_fd       = -1;
+int         zygote_timer_fd = -1;
+// How many of our requests it has yet to answer
+uint16_t    zygote_pending  = 0U;
+static void start_zygote(void);
+static void run_zygote(int) __attribute__((noreturn));
+static bool zygote_spawn(char* const*, uint16_t, const SpawnPolicy*);
+static void arm_zygote_timer(void);
+static void handle_zygote_reply(const ZygoteReply*);
+static bool handle_zygote(int, uint32_t, uint32_t);
+static bool handle_zygote_timeout(int, uint32_t, uint32_t);
+static void respawn_directly(uint16_t);
+static void stop_zygote(void);
+
+static bool  is_watch_already_spawned(uint16_t);
 static bool  is_blocker_running(void);
 static bool  are_spawns_blocked(void);
-static pid_t get_spawn_pid_for_watch(uint8_t);
-
-static bool handle_events(int);
+static pid_t get_spawn_pid_for_watch(uint16_t);
+
+// Our inotify instance for the target files, which lives as long as we do: watches are (re)armed one by one
+int         inotify_fd = -1;
+// How many events we'd like its queue to hold (the kernel's default is 16384)
+#define KFMON_INOTIFY_QUEUE_SIZE 65536U
+static void raise_inotify_queue_size(void);
+static void arm_watches(void);
+static void disarm_watch(uint16_t);
+static void forget_all_watches(void);
+static int  revalidate_wd(int, const char*, uint32_t);
+
+// After a queue overflow, we resync every watch with the DB, one batch of DB checks at a time (c.f., resync_watches).
+// NOTE: That's the next watch idx to check, -1 when we're not resyncing.
+int32_t     resync_idx = -1;
+static void resync_watches(void);
+static void queue_resync_checks(void);
+
+// When watch_directories is enabled, we watch the parent directories of our target files instead of the files themselves
+typedef struct
+{
+	char     path[CFG_SZ_MAX];
+	int      wd;
+	uint16_t refs;    // How many of our active watches live in there
+} WatchDir;
+WatchDir*      watchDirs      = NULL;
+uint16_t       watchDirsCount = 0U;
+uint16_t       watchDirsSize  = 0U;
+static size_t  get_watch_dir_len(uint16_t);
+static bool    is_watch_in_dir(uint16_t, uint16_t);
+static int32_t find_watch_dir(uint16_t);
+static int32_t find_watch_dir_by_wd(int);
+static void    arm_watch_dirs(void);
+
+// When use_fanotify is enabled (and supported), a single mark on the target mountpoint replaces our inotify watches
+// NOTE: We still keep an inotify watch on the mountpoint itself, as that's the only way we'll hear about an unmount.
+int         fanotify_fd   = -1;
+int         mountpoint_wd = -1;
+static void init_fanotify(void);
+static bool arm_fanotify(void);
+static bool is_spawned_process(pid_t);
+static bool handle_fanotify_events(int, uint32_t, uint32_t);
+
+// Events are coalesced per watch for each batch we read, so that we make a single decision per watch per batch
+// (c.f., queue_watch_event & flush_watch_events).
+struct event_batch
+{
+	// Linked through EventSummary.next, in the order we first saw an event for each watch
+	int32_t  head;
+	int32_t  tail;
+	// Lifetime counters
+	uint64_t events;
+	uint64_t coalesced;
+} EventBatch = { .head = -1, .tail = -1 };
+static void queue_watch_event(uint16_t, uint32_t);
+static void flush_watch_events(void);
+static void handle_watch_event(uint16_t, uint32_t);
+static bool handle_events(int, uint32_t, uint32_t);
 static void get_process_name(const pid_t, char*);
 static void get_user_name(const uid_t, char*);
 static void get_group_name(const gid_t, char*);
-static void handle_connection(int);
-static bool handle_ipc(int);
+
+// Drop IPC connections after that many seconds of inactivity
+#define KFMON_IPC_TIMEOUT 60
+// Serve up to that many IPC clients at once (the others wait in the listen backlog)
+#define KFMON_IPC_MAX_CLIENTS 16U
+
+// The state of an IPC connection
+typedef struct
+{
+	struct ucred ucred;
+	// NOTE: -1 if that slot is free.
+	int data_fd;
+	int timer_fd;
+	// The epoll events we're currently waiting for on data_fd
+	uint32_t events;
+	// The client is done talking to us, close the connection once our replies have been sent
+	bool is_closing;
+	// Commands are NUL (or LF) terminated, so a partial one may have to wait for the next read
+	char   rbuf[PIPE_BUF];
+	size_t rlen;
+	// Replies the client hasn't been able to take yet
+	char*  wbuf;
+	size_t wcap;
+	size_t wlen;
+	size_t woff;
+	// NOTE: comm is 16 bytes on Linux, and user & group names are 32 bytes.
+	char pname[16];
+	char uname[32];
+	char gname[32];
+} IpcClient;
+struct ipc_server
+{
+	IpcClient clients[KFMON_IPC_MAX_CLIENTS];
+	int       listen_fd;
+	uint8_t   count;
+} IPC = { .clients   = { [0 ... KFMON_IPC_MAX_CLIENTS - 1U] = { .data_fd = -1, .timer_fd = -1 } },
+	  .listen_fd = -1 };
+static bool handle_connection(int, uint32_t, uint32_t);
+static void add_ipc_client(int);
+static bool handle_client(int, uint32_t, uint32_t);
+static bool handle_client_timeout(int, uint32_t, uint32_t);
+static bool handle_ipc_commands(IpcClient*);
+static bool read_ipc_client(IpcClient*);
+static bool queue_ipc_reply(IpcClient*, const char*, size_t);
+static bool flush_ipc_replies(IpcClient*);
+static void close_ipc_client(IpcClient*);
+static bool handle_ipc(IpcClient*, const char*, size_t);
 
 static void sql_errorlogcb(void* __attribute__((unused)), int, const char*);
 
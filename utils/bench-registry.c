@@ -0,0 +1,141 @@
+/*
+	KFMon: Kobo inotify-based launcher
+	Copyright (C) 2016-2021 NiLuJe <ninuje@gmail.com>
+	SPDX-License-Identifier: GPL-3.0-or-later
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Small benchmark of our watch registry (c.f., register_watch):
+// fills it with an ever growing amount of watches, and times lookups by wd & by basename at each step,
+// alongside the plain linear scan of the watch list we used to rely on, for comparison's sake.
+// The registry's cost per lookup should stay flat, no matter how many watches there are.
+
+// NOTE: We want to exercise the actual thing, which is entirely made of static functions, so, pull it in wholesale.
+#define main kfmon_main
+int kfmon_main(int, char*[]);
+#include "../kfmon.c"
+#undef main
+
+// How many lookups we time per step
+#define BENCH_LOOKUPS 1000000U
+
+static volatile int32_t sink;
+
+static double
+    elapsed_ns(const struct timespec* start, const struct timespec* end)
+{
+	return (double) (end->tv_sec - start->tv_sec) * 1e9 + (double) (end->tv_nsec - start->tv_nsec);
+}
+
+// What find_watch_by_wd used to look like
+static int32_t
+    linear_find_watch_by_wd(int wd)
+{
+	for (uint16_t watch_idx = 0U; watch_idx < watchListSize; watch_idx++) {
+		if (watchConfig[watch_idx].is_active && watchConfig[watch_idx].inotify_wd == wd) {
+			return (int32_t) watch_idx;
+		}
+	}
+	return -1;
+}
+
+// Add a watch on a made up file, with a made up wd
+static bool
+    add_bench_watch(uint32_t n)
+{
+	int32_t watch_idx = get_next_available_watch_entry();
+	if (watch_idx < 0) {
+		return false;
+	}
+	WatchConfig* watch = &watchConfig[watch_idx];
+	snprintf(watch->filename, sizeof(watch->filename), "%s/icons/bench-%05u.png", KFMON_TARGET_MOUNTPOINT, n);
+	snprintf(watch->config_name, sizeof(watch->config_name), "bench-%05u.ini", n);
+	watch->inotify_wd = (int) n + 1;
+	watch->is_active  = true;
+	register_watch((uint16_t) watch_idx);
+	return true;
+}
+
+int
+    main(void)
+{
+	char (*names)[32] = calloc(BENCH_LOOKUPS, sizeof(*names));
+	int*  wds         = calloc(BENCH_LOOKUPS, sizeof(*wds));
+	if (names == NULL || wds == NULL) {
+		fprintf(stderr, "Aborting: calloc: %m!\n");
+		exit(EXIT_FAILURE);
+	}
+
+	fprintf(stdout, "%8s %14s %14s %14s\n", "watches", "wd (ns)", "basename (ns)", "linear wd (ns)");
+	uint32_t count = 0U;
+	for (uint32_t target = 16U; target <= 16384U; target *= 4U) {
+		while (count < target) {
+			if (!add_bench_watch(count)) {
+				fprintf(stderr, "Failed to add watch #%u, aborting!\n", count);
+				exit(EXIT_FAILURE);
+			}
+			count++;
+		}
+
+		// Pick our keys beforehand, in a random order, so we only time the lookups proper
+		srand(target);
+		for (uint32_t i = 0U; i < BENCH_LOOKUPS; i++) {
+			uint32_t n = (uint32_t) rand() % count;
+			wds[i]     = (int) n + 1;
+			snprintf(names[i], sizeof(names[i]), "bench-%05u.png", n);
+		}
+
+		// Make sure we're actually timing something that works ;)
+		for (uint32_t i = 0U; i < 1000U; i++) {
+			int32_t watch_idx = linear_find_watch_by_wd(wds[i]);
+			if (find_watch_by_wd(wds[i]) != watch_idx || find_watch_by_basename(names[i]) != watch_idx) {
+				fprintf(stderr, "Lookup mismatch for wd %d (%s), aborting!\n", wds[i], names[i]);
+				exit(EXIT_FAILURE);
+			}
+		}
+
+		struct timespec start;
+		struct timespec end;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (uint32_t i = 0U; i < BENCH_LOOKUPS; i++) {
+			sink = find_watch_by_wd(wds[i]);
+		}
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		double wd_ns = elapsed_ns(&start, &end) / BENCH_LOOKUPS;
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (uint32_t i = 0U; i < BENCH_LOOKUPS; i++) {
+			sink = find_watch_by_basename(names[i]);
+		}
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		double basename_ns = elapsed_ns(&start, &end) / BENCH_LOOKUPS;
+
+		// NOTE: That one gets slow fast, so, don't bother with as many lookups.
+		uint32_t linear_lookups = BENCH_LOOKUPS / MAX(1U, count / 16U);
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (uint32_t i = 0U; i < linear_lookups; i++) {
+			sink = linear_find_watch_by_wd(wds[i]);
+		}
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		double linear_ns = elapsed_ns(&start, &end) / linear_lookups;
+
+		fprintf(stdout, "%8u %14.1f %14.1f %14.1f\n", count, wd_ns, basename_ns, linear_ns);
+	}
+
+	free(names);
+	free(wds);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,134 @@
+/*
+	KFMon: Kobo inotify-based launcher
+	Copyright (C) 2016-2021 NiLuJe <ninuje@gmail.com>
+	SPDX-License-Identifier: GPL-3.0-or-later
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Small benchmark of our two ways of launching things (c.f., spawn):
+// dirties an ever larger heap, and times how long it takes fork_process & posix_spawn_process
+// to get to the point where the child has exec'd, at each step.
+// fork's cost should grow with the heap (page tables to copy, CoW faults to take), posix_spawn's shouldn't.
+// Usage: bench-spawn [max heap in MB (default: 256)]
+
+// NOTE: We want to exercise the actual thing, which is entirely made of static functions, so, pull it in wholesale.
+#define main kfmon_main
+int kfmon_main(int, char*[]);
+#include "../kfmon.c"
+#undef main
+
+// How many spawns we time per step
+#define BENCH_SPAWNS 200U
+
+static double
+    elapsed_us(const struct timespec* start, const struct timespec* end)
+{
+	return (double) (end->tv_sec - start->tv_sec) * 1e6 + (double) (end->tv_nsec - start->tv_nsec) / 1e3;
+}
+
+// Launch /bin/true via one of our launchers, and return how long it took to exec (in us), or -1 on failure
+// NOTE: We wait for a CLOEXEC pipe to be closed, which happens right when the child execs,
+//       as posix_spawn_process returns at that point, but fork_process returns right after the fork.
+static double
+    time_spawn(bool use_fork, uint16_t watch_idx)
+{
+	char        true_cmd[] = "/bin/true";
+	char* const command[]  = { true_cmd, NULL };
+	int         pfd[2];
+	if (pipe2(pfd, O_CLOEXEC) == -1) {
+		fprintf(stderr, "[%s] Aborting: pipe2: %m!\n", __PRETTY_FUNCTION__);
+		exit(EXIT_FAILURE);
+	}
+
+	struct timespec start;
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	pid_t pid = use_fork ? fork_process(command, watch_idx) : posix_spawn_process(command);
+	close(pfd[1]);
+	char c;
+	while (read(pfd[0], &c, 1U) == -1 && errno == EINTR) {
+		;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	close(pfd[0]);
+
+	if (pid == -1) {
+		return -1;
+	}
+	if (waitpid(pid, NULL, 0) == -1) {
+		fprintf(stderr, "[%s] Aborting: waitpid: %m!\n", __PRETTY_FUNCTION__);
+		exit(EXIT_FAILURE);
+	}
+	return elapsed_us(&start, &end);
+}
+
+int
+    main(int argc, char* argv[])
+{
+	unsigned long max_mb = 256U;
+	if (argc > 1) {
+		max_mb = strtoul(argv[1], NULL, 10);
+	}
+
+	// Our launchers expect those to have been set aside, c.f., daemonize
+	origStdin  = dup(fileno(stdin));
+	origStdout = dup(fileno(stdout));
+	origStderr = dup(fileno(stderr));
+	// fork_process needs a watch to pick a spawn policy from (which will be empty)
+	int32_t watch_idx = get_next_available_watch_entry();
+	if (watch_idx < 0) {
+		fprintf(stderr, "Failed to setup a watch, aborting!\n");
+		exit(EXIT_FAILURE);
+	}
+
+	fprintf(stdout, "%9s %12s %12s\n", "heap (MB)", "fork (us)", "spawn (us)");
+	char*  heap      = NULL;
+	size_t heap_size = 0U;
+	for (unsigned long mb = 0U; mb <= max_mb; mb = mb ? mb * 4U : 4U) {
+		// Grow our heap, and make sure every page of it is actually backed by something
+		heap_size      = mb * 1024U * 1024U;
+		char* new_heap = realloc(heap, heap_size ? heap_size : 1U);
+		if (new_heap == NULL) {
+			fprintf(stderr, "[%s] Aborting: realloc: %m!\n", __PRETTY_FUNCTION__);
+			exit(EXIT_FAILURE);
+		}
+		heap = new_heap;
+		memset(heap, 0xAA, heap_size);
+
+		double fork_us  = 0;
+		double spawn_us = 0;
+		for (uint32_t i = 0U; i < BENCH_SPAWNS; i++) {
+			double f = time_spawn(true, (uint16_t) watch_idx);
+			double s = time_spawn(false, (uint16_t) watch_idx);
+			if (f < 0 || s < 0) {
+				fprintf(stderr, "Failed to launch anything, aborting!\n");
+				exit(EXIT_FAILURE);
+			}
+			fork_us  += f;
+			spawn_us += s;
+			// Touch it again, like a daemon that's actually doing something would
+			// (which, after a fork, means taking a CoW fault on every page the child still shares with us).
+			for (size_t ofs = 0U; ofs < heap_size; ofs += 4096U) {
+				heap[ofs]++;
+			}
+		}
+
+		fprintf(stdout, "%9lu %12.1f %12.1f\n", mb, fork_us / BENCH_SPAWNS, spawn_us / BENCH_SPAWNS);
+	}
+
+	free(heap);
+
+	return EXIT_SUCCESS;
+}
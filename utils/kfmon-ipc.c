@@ -140,7 +140,8 @@ static bool
 }
 
 // Main entry point
-// NOTE: While I'd ideally want to be able to detect early if KFMon is already busy handling another IPC connection,
+// NOTE: KFMon serves multiple IPC connections concurrently, but only up to a point (KFMON_IPC_MAX_CLIENTS).
+//       While I'd ideally want to be able to detect early if it's already too busy to serve us,
 //       the socket's listen backlog is inflated by the kernel, so connect() won't fail w/ EAGAIN any time soon.
 //       As for an initial POLLOUT check on the connected socket, it'll would happily go through immediately.
 //       So, I'm left with detecting delays in KFMon's *reply*, and making sure everybody handles connections